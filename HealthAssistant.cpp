@@ -31,6 +31,27 @@ Description       :A program that with users to calculate
 #include <vector>
 #include <optional>
 #include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <random>
+#include <array>
+#include <filesystem>
+#include <map>
+#include <limits>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <numeric>
+#include <shared_mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* -- Functions -- */
 
@@ -42,6 +63,47 @@ std::string trim(const std::string &str);
 
 /* -- Global Fields -- */
 enum class BfpType { BmiMethod, USNavyMethod };
+enum class Gender : std::uint8_t { Unknown, Male, Female };
+enum class Lifestyle : std::uint8_t { Unknown, Sedentary, Moderate, Active };
+enum class BfpCategory : std::uint8_t { Unknown, Low, Normal, High, VeryHigh };
+enum class AgeBracket : std::uint8_t { Other, Age20To39, Age40To59, Age60To79 };
+
+/**
+ * @brief Floating point width used for the measurement columns and the BFP/BMI kernels.
+ *
+ * Float doubles the SIMD width of the BFP/BMI column kernel. It only changes how the BFP is
+ * computed: users, UserTable columns and the compute cache still hold doubles, since the query
+ * engine scans the numeric columns as double arrays, so it saves no memory. The BFP is truncated to
+ * an int anyway, so the only visible difference is a value sitting right at a threshold.
+ *
+ * "make sweep" runs both precisions over every tuple of the 0.5 cm / 0.1 kg input grid (heights
+ * 150-200 cm, weights 40-150 kg, waists 60-130 cm, necks 28-50 cm, hips 80-130 cm, one age per
+ * bracket) and reports:
+ * - BMI: 0 category flips out of 111k tuples; 3 truncated BFP values (2.7e-5) differ by one.
+ * - US Navy: 0 category flips and 0 BFP differences out of 196M tuples.
+ * Values off that grid are not covered; a flip needs a value within float rounding (about 1e-6
+ * relative) of a category threshold.
+ */
+enum class ComputePrecision { Double, Float };
+
+/**
+ * @brief Version of the BFP, calorie and macronutrient formulas.
+ *
+ * Stored with the results in extended CSV records; bump it whenever a formula changes so that
+ * results written by the previous formulas are recomputed instead of trusted.
+ */
+const int kFormulaVersion = 1;
+
+Gender genderFromString(const std::string &gender);
+Lifestyle lifestyleFromString(const std::string &lifestyle);
+std::string categoryLabel(BfpType bfpType, BfpCategory category);
+BfpCategory categoryFromLabel(const std::string &label);
+AgeBracket ageBracketOf(int age);
+std::string genderName(Gender gender);
+std::string lifestyleName(Lifestyle lifestyle);
+std::string categoryName(BfpCategory category);
+std::string ageBracketName(AgeBracket bracket);
+std::uint64_t hashName(const std::string &name);
 
 /**
  * @struct UserInfo
@@ -57,6 +119,7 @@ struct UserInfo {
     double protein = 0.0;                  ///< Daily protein intake of the user in grams.
     double fat = 0.0;                      ///< Daily fat intake of the user in grams.
     std::pair<int, std::string> bfp;       ///< Body Fat Percentage (BFP) as a pair of percentage and category.
+    std::optional<BfpType> bfpType;        ///< Method the BFP was computed with; empty until it has been computed.
     int daily_calories = 0;                ///< Daily caloric intake of the user.
     double hip = 0.0;                      ///< Hip circumference of the user in centimeters.
     std::string name = "";                 ///< Name of the user.
@@ -64,2096 +127,8363 @@ struct UserInfo {
     std::string lifestyle = "";            ///< Lifestyle category of the user.
 };
 
-/* -- Classes -- */
+std::optional<BfpType> parseUserRecord(const std::string &line, UserInfo *user);
 
 /**
- * @class UserInfoManager
- * @brief Manages user information using a linked list.
+ * @struct ComputeCacheStats
+ * @brief Hit and miss counters reported by ComputeCache.
+ */
+struct ComputeCacheStats {
+    std::size_t hits = 0;                  ///< Lookups answered from the cache.
+    std::size_t misses = 0;                ///< Lookups that required a full computation.
+    std::size_t entries = 0;               ///< Number of distinct tuples currently cached.
+
+    double hitRate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses); }
+};
+
+/**
+ * @struct RunningMoments
+ * @brief Count, mean and variance of a column, accumulated with Welford's algorithm.
  *
- * This class provides functionality to manage user information through a linked list.
- * It includes methods for adding, deleting, reading from/writing to files, and displaying
- * user information.
+ * Partial moments of disjoint row ranges are combined with merge(), which is what makes them usable
+ * as the partial result of deterministicReduce.
  */
-class UserInfoManager
-{
-    public:
-        void addUserInfo(); // adds info to list
-        void deleteUser(std::string username); // removes a user
-        void readFromFile(std::string filename); // read and populate list
-        void writeToFile(std::string filename);
-        void display(std::string username);
-        void displayAll();
+struct RunningMoments {
+    std::size_t count = 0;                 ///< Number of values accumulated.
+    double mean = 0.0;                     ///< Running mean of the values.
+    double m2 = 0.0;                       ///< Sum of squared differences from the mean.
+
+    void add(double value);
+    void merge(const RunningMoments &other);
+    double variance() const { return count < 2 ? 0.0 : m2 / (count - 1); }
+};
 
-        // Utilities
-        UserInfo *getUserInfo(std::string username);
-        void addUserInfo(UserInfo *userInfo);
+/**
+ * @brief Numeric columns of a UserTable.
+ */
+enum class Column { Age, Weight, Waist, Neck, Hip, Height, Bfp, Bmi, DailyCalories, Carbs, Protein, Fat, Count };
 
-    private:
-        std::vector<UserInfo*> userInfoList;
-        void displayUser(UserInfo *userInfo);
+const std::size_t kColumnCount = static_cast<std::size_t>(Column::Count);
 
-        // Commandline user input
-        void getGender(UserInfo *user);
-        void getHipMeasurement(UserInfo *user);
-        void getAge(UserInfo *user);
-        void getBodyWeightMeasurement(UserInfo *user);
-        void getWaistMeasurement(UserInfo *user);
-        void getNeckMeasurement(UserInfo *user);
-        void getHeightMeasurement(UserInfo *user);
-        void getLifestyle(UserInfo *user);
-        void getName(UserInfo *user);
-    };
+std::string columnName(Column column);
 
 /**
- * @class HealthAssistant
- * @brief Manages health-related functionalities by wrapping around UserInfoManager.
+ * @class HyperLogLog
+ * @brief Fixed-size sketch estimating the number of distinct values added to it.
  *
- * This class acts as a wrapper around UserInfoManager, providing simplified methods
- * for managing user health information. It includes methods for getting user details,
- * Body Fat Percentage (BFP), Daily Calories, Meal Preparation details, and more. It also
- * acts as a bridge to UserInfoManager for operations like serialization, reading from files,
- * deleting users, and mass loading and computing.
+ * 2^14 one-byte registers give a standard error of about 0.8% whatever the cardinality, and two
+ * sketches are merged by taking the register-wise maximum.
  */
-class HealthAssistant
+class HyperLogLog
 {
     public:
-        virtual ~HealthAssistant() {};
-        void getUserDetails(); // wrapper method that simply calls addUserInfo in class UserInfoManager
-        virtual void getBfp(std::string username) = 0;
-        void getDailyCalories(std::string username);
-        void getMealPrep(std::string username);
-        void display(std::string username); // wrapper method
-        void serialize(std::string filename); // wrapper method
-        void readFromFile(std::string filename); // wrapper method
-        void deleteUser(std::string username); // wrapper method
-        void massLoadAndCompute(std::string filename);
-    protected:
-        static UserInfoManager userInfoManager;
+        HyperLogLog() : registers(std::size_t(1) << kPrecision, 0) {}
+        void add(std::uint64_t hash);
+        void merge(const HyperLogLog &other);
+        double estimate() const;
+
     private:
-        virtual void getBfp(UserInfo *user) = 0;
-        void getDailyCalories(UserInfo *user);
-        void getMealPrep(UserInfo *user);
+        static const unsigned kPrecision = 14;
+        std::vector<std::uint8_t> registers;
+};
+
+/**
+ * @struct UserTable
+ * @brief Column-oriented table of loaded users together with their computed health metrics.
+ *
+ * This is the form in which UserStats keeps a loaded data file. Every numeric attribute lives in its
+ * own contiguous array and the categorical attributes are stored as one-byte codes, so queries scan
+ * plain arrays instead of chasing UserInfo pointers and comparing strings. Bmi is filled in for every
+ * user regardless of the method used for the Bfp column.
+ */
+struct UserTable {
+    BfpType bfpType = BfpType::BmiMethod;                    ///< Method used to compute the Bfp column.
+    std::vector<std::string> names;                          ///< Name of every user.
+    std::vector<Gender> gender;                              ///< Gender code of every user.
+    std::vector<Lifestyle> lifestyle;                        ///< Lifestyle code of every user.
+    std::vector<BfpCategory> category;                       ///< Body fat category of every user.
+    std::array<std::vector<double>, kColumnCount> columns;   ///< Numeric columns, indexed by Column.
+    HyperLogLog distinctNames;                               ///< Sketch of the distinct names, filled by append().
+
+    std::size_t size() const { return names.size(); }
+    const std::vector<double> &column(Column c) const { return columns[static_cast<std::size_t>(c)]; }
+    void reserve(std::size_t count);
+    void append(const UserInfo *user);
+    void appendRow(const UserTable &from, std::size_t row);
 };
 
-// Initialize the static member variable userInfoManager
-UserInfoManager HealthAssistant::userInfoManager;
+enum class Field { Gender, Lifestyle, Category, Numeric };
+enum class CompareOp { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+enum class AggregateOp { Count, Sum, Mean, Min, Max, Variance };
 
 /**
- * @brief The USNavyMethod class represents a health assistant that implements the US Navy method
- * for calculating body fat percentage (BFP).
+ * @struct Condition
+ * @brief A single comparison of a UserTable field against a constant.
  *
- * This class inherits from the HealthAssistant class and provides implementations for calculating
- * BFP using the US Navy method.
+ * Categorical fields compare their code, so Condition::is(Gender::Female) selects female users.
  */
-class USNavyMethod : public HealthAssistant
+struct Condition {
+    Field field = Field::Numeric;          ///< Field compared.
+    Column column = Column::Age;           ///< Column compared when field is Field::Numeric.
+    CompareOp op = CompareOp::Equal;       ///< Comparison operator.
+    double value = 0.0;                    ///< Constant (or category code) compared against.
+
+    static Condition on(Column column, CompareOp op, double value);
+    static Condition is(Gender gender);
+    static Condition is(Lifestyle lifestyle);
+    static Condition is(BfpCategory category);
+    static Condition isNot(BfpCategory category);
+    bool operator==(const Condition &other) const;
+};
+
+/**
+ * @struct ColumnAccumulator
+ * @brief Partial count, sum, min, max and moments of one column over the rows matching a filter.
+ */
+struct ColumnAccumulator {
+    std::size_t count = 0;                                          ///< Number of matching rows.
+    double sum = 0.0;                                               ///< Sum of the column.
+    double min = std::numeric_limits<double>::infinity();           ///< Smallest value seen.
+    double max = -std::numeric_limits<double>::infinity();          ///< Largest value seen.
+    RunningMoments moments;                                         ///< Mean and variance of the column.
+
+    void merge(const ColumnAccumulator &other);
+};
+
+/**
+ * @class AggregateQuery
+ * @brief A set of aggregates evaluated together in one fused scan of a UserTable.
+ *
+ * Each aggregate is an operation on a column restricted to the rows matching its own conjunction of
+ * conditions. Aggregates sharing a filter share its selection mask, and aggregates sharing a filter
+ * and a column share one accumulator, so asking for the mean, min and variance of a column costs the
+ * same single pass as asking for one of them. Adding a statistic means adding an aggregate, never
+ * another pass over the data.
+ */
+class AggregateQuery
 {
     public:
-        void getBfp(std::string username) override;
+        std::size_t add(AggregateOp op, Column column, std::vector<Condition> where = {});
+        std::size_t count(std::vector<Condition> where = {});
+        std::vector<double> run(const std::vector<std::shared_ptr<const UserTable>> &tables, unsigned threadCount) const;
+        bool reads(Column column) const;
+
     private:
-        void getBfp(UserInfo *user) override;
+        struct Spec {
+            AggregateOp op;
+            std::size_t slot;
+        };
+        struct Slot {
+            std::size_t filter;
+            Column column;                 // Column::Count for slots that only count rows
+        };
+
+        std::vector<std::vector<Condition>> filters;
+        std::vector<Slot> slots;
+        std::vector<Spec> specs;
+
+        std::vector<ColumnAccumulator> scan(const UserTable &table, std::size_t begin, std::size_t end) const;
 };
 
 /**
- * @brief The BmiMethod class represents a health assistant that implements the BMI method
- * for calculating body fat percentage (BFP).
+ * @struct GroupStats
+ * @brief Count, mean BFP and mean daily calories of one method x gender x age bracket x lifestyle x category group.
+ */
+struct GroupStats {
+    BfpType method = BfpType::BmiMethod;             ///< Method the BFP and category of the group were computed with.
+    Gender gender = Gender::Unknown;                 ///< Gender of the group.
+    AgeBracket ageBracket = AgeBracket::Other;       ///< Age bracket of the group.
+    Lifestyle lifestyle = Lifestyle::Unknown;        ///< Lifestyle of the group.
+    BfpCategory category = BfpCategory::Unknown;     ///< Body fat category of the group.
+    std::size_t count = 0;                           ///< Number of users in the group.
+    double meanBfp = 0.0;                            ///< Mean body fat percentage of the group.
+    double meanCalories = 0.0;                       ///< Mean daily caloric intake of the group.
+};
+
+/**
+ * @class QuantileSketch
+ * @brief Mergeable streaming quantile sketch (KLL).
  *
- * This class inherits from the HealthAssistant class and provides implementations for calculating
- * BFP using the BMI method.
+ * Values are kept in a stack of compactors; an item at level l stands for 2^l original values.
+ * When a level outgrows its capacity it is sorted and every other item is promoted to the next
+ * level, so memory stays around 3k items whatever the stream length, and the rank error of a
+ * quantile is roughly 1.7/k of the count. Sketches of disjoint inputs are combined with merge().
+ * The promoted half alternates deterministically instead of being drawn at random, so building
+ * and merging sketches in the same order always gives the same answers.
  */
-class BmiMethod : public HealthAssistant
+class QuantileSketch
 {
     public:
-        void getBfp(std::string username) override;
+        explicit QuantileSketch(std::size_t k = 200);
+        void add(double value);
+        void merge(const QuantileSketch &other);
+        double quantile(double q) const;
+        std::size_t count() const { return n; }
+
     private:
-        void getBfp(UserInfo *user) override;
+        std::size_t k;
+        std::size_t n = 0;
+        std::size_t compactions = 0;
+        std::vector<std::vector<double>> levels;
+
+        std::size_t capacity(std::size_t level) const;
+        void compress();
 };
 
 /**
- * @brief The UserStats class represents a utility class for managing and retrieving user statistics.
- *
- * This class provides methods to retrieve information about healthy and unfit users based on different
- * criteria and methods, as well as to compute full statistics for all users.
+ * @class FixedHistogram
+ * @brief Histogram with equal-width buckets over a fixed range, plus underflow and overflow counts.
  */
-class UserStats
+class FixedHistogram
 {
     public:
-        std::vector<std::string> GetHealthyUsers(std::string method, std::string gender);
-        std::vector<std::string> GetHealthyUsers(std::string method);
-        std::vector<std::string> GetUnfitUsers(std::string method, std::string gender);
-        std::vector<std::string> GetUnfitUsers(std::string method);
-        void GetFullStats();
+        FixedHistogram(double low = 0.0, double high = 1.0, std::size_t buckets = 10);
+        void add(double value);
+        void merge(const FixedHistogram &other);
+        double bucketLow(std::size_t bucket) const { return low + bucket * width; }
+        double bucketHigh(std::size_t bucket) const { return low + (bucket + 1) * width; }
+        const std::vector<std::size_t> &counts() const { return bucketCounts; }
+        std::size_t underflow() const { return below; }
+        std::size_t overflow() const { return above; }
+
     private:
-        std::shared_ptr<std::vector<UserInfo*>> massLoadAndCompute(std::string filename, BfpType bfpType);
-        void usNavyMethod(UserInfo *user);
-        void bmiMethod(UserInfo *user);
-        void getDailyCalories(UserInfo *user);
-        void getMealPrep(UserInfo *user);
+        double low;
+        double width;
+        std::vector<std::size_t> bucketCounts;
+        std::size_t below = 0;
+        std::size_t above = 0;
 };
 
-/* -- Main Program -- */
-int main(int argc, char* argv[])
+/**
+ * @struct CohortDistribution
+ * @brief Quantiles and histogram of a column for one method x gender x age bracket cohort.
+ */
+struct CohortDistribution {
+    BfpType method = BfpType::BmiMethod;             ///< Method of the data file the cohort comes from.
+    Gender gender = Gender::Unknown;                 ///< Gender of the cohort.
+    AgeBracket ageBracket = AgeBracket::Other;       ///< Age bracket of the cohort.
+    QuantileSketch sketch;                           ///< Quantile sketch of the column.
+    FixedHistogram histogram;                        ///< Histogram of the column.
+};
+
+/**
+ * @class RowSet
+ * @brief Query result referring to rows of the cached tables instead of copying them.
+ *
+ * A RowSet holds the matching row ids of each table together with a shared reference to the table,
+ * so the names it hands out as std::string_view stay valid for as long as the RowSet exists, even
+ * if the data file is reloaded meanwhile. Nothing is printed unless print() is called.
+ */
+class RowSet
 {
-    HealthAssistant* ha = new USNavyMethod();
-    std::string userInput;
-    // Loop until the user inputs "exit"
-    while (true)
-    {
-        // Get user details
-        ha->getUserDetails();
-        // Ask for user input
-        std::cout << "Enter 'exit' to quit, or press Enter to continue:";
-        std::getline(std::cin, userInput);
-        std::cout << std::endl;
-        // Check if the user wants to exit
-        if (userInput == "exit")
+    public:
+        /**
+         * @brief The matching rows of one table, ascending.
+         */
+        struct Segment {
+            std::shared_ptr<const UserTable> table;
+            std::vector<std::uint32_t> rows;
+        };
+
+        void add(std::shared_ptr<const UserTable> table, std::vector<std::uint32_t> rows);
+        std::size_t size() const;
+        bool empty() const { return size() == 0; }
+        const std::vector<Segment> &segments() const { return parts; }
+        std::vector<std::string_view> names() const;
+        std::vector<std::string> toStrings() const;
+        void print(std::ostream &out) const;
+
+        /**
+         * @brief Calls a function with the name of every row, in result order.
+         *
+         * @param visit Callable taking a std::string_view.
+         */
+        template<typename Visit>
+        void forEachName(Visit &&visit) const
         {
-            break; // exit the loop
+            for (const Segment &segment : parts)
+            {
+                for (std::uint32_t row : segment.rows)
+                {
+                    visit(std::string_view(segment.table->names[row]));
+                }
+            }
         }
-    }
 
-    std::cout << "USNavyMethod before calculation" << std::endl;
-    ha->display("all");
-    ha->getBfp("john");
-    ha->getDailyCalories("john");
-    ha->getMealPrep("john");
-    ha->serialize("us_user_data.csv");
-    std::cout << "USNavyMethod after calculation" << std::endl;
-    ha->display("all"); // only john's information is computed at this point
-    delete ha;
+    private:
+        std::vector<Segment> parts;
+};
 
-    ha = new BmiMethod();
-    // Loop until the user inputs "exit"
-    while (true)
-    {
-        // Get user details
-        ha->getUserDetails();
-        // Ask for user input
-        std::cout << "Enter 'exit' to quit, or press Enter to continue:";
-        std::getline(std::cin, userInput);
-        // Check if the user wants to exit
-        if (userInput == "exit")
-        {
-            break; // Exit the loop
-        }
-    }
+/**
+ * @struct ApproximateProportion
+ * @brief A proportion estimated from a sample, with its 95% confidence interval.
+ */
+struct ApproximateProportion {
+    double estimate = 0.0;                           ///< Estimated proportion, between 0 and 1.
+    double low = 0.0;                                ///< Lower bound of the 95% confidence interval.
+    double high = 0.0;                               ///< Upper bound of the 95% confidence interval.
+};
 
-    std::cout << "BmiMethod before calculation" << std::endl;
-    ha->display("all");
-    ha->getBfp("john");
-    ha->getDailyCalories("john");
-    ha->getMealPrep("john");
-    ha->deleteUser("jack"); // assuming we have a user jack
-    std::cout << "BmiMethod after calculation" << std::endl;
-    ha->display("all"); // should display all except for jack
-    ha->serialize("bmi_user_data.csv");
-    delete ha;
+/**
+ * @struct ApproximateStats
+ * @brief Sampled population statistics returned by UserStats::GetApproximateStats.
+ */
+struct ApproximateStats {
+    std::size_t population = 0;                      ///< Number of users in the data files.
+    std::size_t sampleSize = 0;                      ///< Number of users sampled.
+    ApproximateProportion healthy;                   ///< Proportion of users in the Normal category.
+    ApproximateProportion male;                      ///< Proportion of male users.
+    ApproximateProportion female;                    ///< Proportion of female users.
+    double distinctNames = 0.0;                      ///< Estimated number of distinct names.
+};
 
-    ha = new USNavyMethod();
-    ha->massLoadAndCompute("us_user_data.csv");
-    std::cout << "USNavyMethod after massLoadAndCompute" << std::endl;
-    ha->display("all");
-    delete ha;
-    ha = new BmiMethod();
-    ha->massLoadAndCompute("bmi_user_data.csv");
-    std::cout << "BmiMethod after massLoadAndCompute" << std::endl;
-    ha->display("all");
-    delete ha;
+/**
+ * @struct ColumnarScanStats
+ * @brief What UserStats::LoadColumnar read, and what its block statistics let it skip.
+ */
+struct ColumnarScanStats {
+    std::size_t rowGroups = 0;                       ///< Row groups in the file.
+    std::size_t rowGroupsSkipped = 0;                ///< Row groups skipped without being read, from their min/max statistics.
+    std::size_t rowsDecoded = 0;                     ///< Rows of the row groups that were read.
+    std::size_t rowsMatched = 0;                     ///< Rows that satisfied the filter.
+};
 
-    UserStats stat;
+/**
+ * @struct JoinedUser
+ * @brief A user found in both data files, with the category each method gives them.
+ */
+struct JoinedUser {
+    std::string_view name;                           ///< Name of the user; valid during the callback.
+    std::uint32_t bmiRow = 0;                        ///< Row of the user in the BMI table.
+    std::uint32_t usNavyRow = 0;                     ///< Row of the user in the US Navy table.
+    BfpCategory bmiCategory = BfpCategory::Unknown;  ///< Category from the BMI method.
+    BfpCategory usNavyCategory = BfpCategory::Unknown; ///< Category from the US Navy method.
+
+    bool agree() const { return bmiCategory == usNavyCategory; }
+};
 
-    stat.GetHealthyUsers("bmi", "female");
-    // stat.GetHealthyUsers("bmi", "male"); // extra test
-    // stat.GetHealthyUsers("USArmy", "female"); // extra test
-    // stat.GetHealthyUsers("USArmy", "male"); // extra test
-    stat.GetHealthyUsers("all");
+/**
+ * @struct MethodAgreement
+ * @brief Result of joining the BMI and US Navy data files by name.
+ */
+struct MethodAgreement {
+    static const std::size_t kCategories = 5;        ///< Number of BfpCategory codes, Unknown included.
 
-    // stat.GetUnfitUsers("bmi", "female"); // extra test
-    // stat.GetUnfitUsers("bmi", "male"); // extra test
-    // stat.GetUnfitUsers("USArmy", "female"); // extra test
-    stat.GetUnfitUsers("USArmy", "male");
-    // stat.GetUnfitUsers("all"); // extra test
-    stat.GetFullStats();
-}
+    std::size_t matched = 0;                         ///< Joined (BMI row, US Navy row) pairs.
+    std::size_t bmiOnly = 0;                         ///< BMI rows without a US Navy row of the same name.
+    std::size_t usNavyOnly = 0;                      ///< US Navy rows without a BMI row of the same name.
+    std::array<std::array<std::size_t, kCategories>, kCategories> matrix{}; ///< Pair counts, by [BMI category][US Navy category].
+    bool mergeJoin = false;                          ///< Whether both tables were sorted by name and merge-joined.
 
-/* -- Function Definitions -- */
+    double agreementRate() const;
+};
 
 /**
- * @brief Adds user information to the linked list maintained by UserInfoManager.
- *
- * This method creates a new UserInfo object, populates it with user details
- * through various helper methods, and adds it to the end of the linked list.
- * If the list is empty, the new UserInfo object becomes the first element;
- * otherwise, it is appended to the end of the existing list.
+ * @struct RankedUser
+ * @brief A user returned by a top-K query, with the value it was ranked by.
  */
-void UserInfoManager::addUserInfo()
-{
-    UserInfo *userInfo = new UserInfo;
+struct RankedUser {
+    std::string name;                                ///< Name of the user.
+    BfpType bfpType = BfpType::BmiMethod;            ///< Method of the data file the user comes from.
+    Lifestyle lifestyle = Lifestyle::Unknown;        ///< Lifestyle of the user.
+    double value = 0.0;                              ///< Value of the ranked column.
+};
 
-    getName(userInfo);
-    getGender(userInfo);
-    getHipMeasurement(userInfo);
-    getAge(userInfo);
-    getBodyWeightMeasurement(userInfo);
-    getWaistMeasurement(userInfo);
-    getNeckMeasurement(userInfo);
-    getHeightMeasurement(userInfo);
-    getLifestyle(userInfo);
-    addUserInfo(userInfo);
-}
+void applyCondition(const UserTable *table, const Condition &condition, std::size_t begin, std::size_t end, std::uint8_t *mask);
 
 /**
- * @brief Wrapper method to add user information using UserInfoManager.
+ * @class FilterProgram
+ * @brief A user filter expression compiled into a flat program over the UserTable columns.
  *
- * This method acts as a simple wrapper, calling the addUserInfo method in the
- * UserInfoManager instance associated with the HealthAssistant class.
+ * Expressions compare fields against constants and combine them with and, or, not and parentheses:
+ *   gender=female and age>=40 and category!=normal and bmi<30
+ * Fields are gender, lifestyle, category, age, weight, waist, neck, hip, height, bfp, bmi, calories,
+ * carbs, protein and fat; categorical fields only support = and !=. The expression is parsed once into
+ * a postfix program. Running it evaluates one instruction at a time over a block of rows: a comparison
+ * is a tight loop over one column producing a byte mask, and and/or/not combine masks, so a filter
+ * runs at scan speed with no per-row interpretation.
  */
-void HealthAssistant::getUserDetails()
+class FilterProgram
 {
-    userInfoManager.addUserInfo();
-}
+    public:
+        static FilterProgram compile(const std::string &expression);
+        void evaluate(const UserTable &table, std::size_t begin, std::size_t end, std::uint8_t *mask) const;
+        void evaluate(const UserTable &table, std::size_t begin, std::size_t end, std::uint8_t *mask,
+                      std::vector<std::uint8_t> &stack) const;
+        std::vector<std::uint32_t> select(const UserTable &table, unsigned threadCount) const;
+        const std::string &text() const { return expression; }
+
+    private:
+        enum class OpCode { Compare, And, Or, Not };
+        struct Instruction {
+            OpCode code;
+            Condition condition;
+        };
+
+        std::string expression;
+        std::vector<Instruction> program;
+        std::size_t stackDepth = 0;
+
+        class Parser;
+};
+
+const std::size_t kReductionChunkSize = 4096; ///< Minimum rows per reduction chunk, fixed so results do not depend on the thread count.
+const std::size_t kMaxReductionChunks = 1024; ///< Upper bound on the number of partial results kept alive by a reduction.
+
+void parallelForChunks(std::size_t chunkCount, unsigned threadCount, const std::function<void(std::size_t)> &body);
+
+template <typename Partial, typename Map, typename Merge>
+Partial deterministicReduce(std::size_t count, unsigned threadCount, Map map, Merge merge);
 
 /**
- * @brief Helper function for centering text within a given width
+ * @struct LiveStats
+ * @brief Population statistics of a UserInfoManager, maintained incrementally.
  *
- * @param input Title of the display information
- * @param width Width for centering
- * @return std::string
+ * Every counter and sum is updated in O(1) when a user is added, deleted or recomputed, so reading
+ * the statistics never scans the users. Sums are kept as integers (weight in grams) so that adding
+ * and later removing a user restores them exactly instead of accumulating rounding drift.
  */
-std::string center(const std::string &input, int width)
-{
-    int inputLength = input.length();
-    int diff = width - inputLength;
-    int pad1 = diff / 2;
-    int pad2 = diff - pad1;
+struct LiveStats {
+    std::size_t users = 0;                                          ///< Number of users.
+    std::array<std::size_t, 3> byGender{};                          ///< Users per Gender code.
+    std::array<std::array<std::array<std::size_t, 3>, 5>, 3> byCategory{}; ///< Users per [method][BfpCategory][Gender]; method 0 is "not computed", 1 BMI, 2 US Navy.
+    std::int64_t weightGrams = 0;                                   ///< Sum of the weights in grams.
+    std::size_t computedUsers = 0;                                  ///< Users with a computed BFP.
+    std::int64_t bfpSum = 0;                                        ///< Sum of the computed BFPs.
+    std::size_t caloriesUsers = 0;                                  ///< Users with computed daily calories.
+    std::int64_t caloriesSum = 0;                                   ///< Sum of the computed daily calories.
+
+    void account(const UserInfo *user, int sign);
+    std::size_t count(BfpType bfpType, BfpCategory category) const;
+    std::size_t count(BfpType bfpType, BfpCategory category, Gender gender) const;
+    double meanWeight() const { return users ? weightGrams / 1000.0 / users : 0.0; }
+    double meanBfp() const { return computedUsers ? static_cast<double>(bfpSum) / computedUsers : 0.0; }
+    double meanCalories() const { return caloriesUsers ? static_cast<double>(caloriesSum) / caloriesUsers : 0.0; }
+};
 
-    if (width < inputLength)
-    {
-        return input;
-    }
+/* -- Classes -- */
 
-    return std::string(pad1, ' ') + input + std::string(pad2, ' ');
-}
+/**
+ * @brief Severity of a log message; messages below the logger's level are discarded.
+ */
+enum class LogLevel : std::uint8_t {
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
 
 /**
- * @brief Converts a double value to a string with fixed precision.
+ * @class Logger
+ * @brief Leveled log sink that keeps console I/O off the calling thread.
  *
- * @param input The double precision floating-point number to be converted into a string.
- * @return std::string A string representation of the input number, formatted to two decimal places.
+ * log() only moves the message into a fixed-size ring buffer; a background thread, started on
+ * the first message, writes batches to the output stream (std::cerr by default) as "[level] text"
+ * lines. When the ring is full new messages are dropped and counted rather than blocking the caller,
+ * and the count is reported with the next batch. The default level is Warn, so per-row diagnostics
+ * such as the readFromFile echo (Debug) cost only a level check. Bulk loads leave the messages to
+ * the background thread; single-user entry points reached from the command line, such as
+ * getBfp(username) and getUserInfo, call flush() before returning so their warnings are printed
+ * before the next prompt.
  */
-std::string double_to_string(double input, int precision)
+class Logger
 {
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(precision) << input;
-    return ss.str();
-}
+    public:
+        static const std::size_t kCapacity = 8192;
+
+        Logger() : ring(kCapacity) {}
+        ~Logger();
+        void setLevel(LogLevel level) { threshold.store(level, std::memory_order_relaxed); }
+        LogLevel level() const { return threshold.load(std::memory_order_relaxed); }
+        bool enabled(LogLevel level) const { return level >= this->level() && level != LogLevel::Off; }
+        void setOutput(std::ostream &out);
+        void log(LogLevel level, std::string message);
+        void flush();
+        static Logger &shared();
+
+    private:
+        std::atomic<LogLevel> threshold{ LogLevel::Warn };
+        std::vector<std::pair<LogLevel, std::string>> ring;
+        std::size_t head = 0;
+        std::size_t count = 0;
+        std::size_t dropped = 0;
+        bool writing = false;
+        bool stopping = false;
+        std::ostream *output = &std::cerr;
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable drained;
+        void drain();
+};
 
 /**
- * @brief Displays a summary of the user's profile.
+ * @class ThreadPool
+ * @brief Fixed set of worker threads that run indexed tasks for the parallel scans.
  *
- * This function presents a comprehensive overview of the user's input data and calculated results,
- * including personal details, body measurements, lifestyle information, body fat percentage,
- * recommended daily caloric intake, and macronutrient needs. The output is formatted to enhance
- * readability and provide a clear understanding of the user's health and nutritional profile.
+ * run() hands out task indices from a shared counter to the calling thread and up to
+ * maxWorkers - 1 pool workers, and returns once every index has been processed. The caller
+ * always works too, so a run() issued from inside a task still completes when every worker is busy.
  */
-void UserInfoManager::displayUser(UserInfo *userInfo)
+class ThreadPool
 {
-    const int width = 60; // Adjust the width based on your output console or preference
-    const int precision = 2;
-
-    std::cout << center("--- USER PROFILE SUMMARY ---", width) << "\n\n";
+    public:
+        explicit ThreadPool(unsigned workerCount);
+        ~ThreadPool();
+        void run(std::size_t taskCount, unsigned maxWorkers, const std::function<void(std::size_t)> &task);
+        unsigned size() const { return static_cast<unsigned>(workers.size()); }
+        static ThreadPool &shared();
 
-    // Personal Details
-    std::cout << center("Personal Details:", width) << "\n";
-    std::cout << center("Name: " + userInfo->name, width) << "\n";
-    std::cout << center("Gender: " + userInfo->gender, width) << "\n";
-    std::cout << center("Age (years): " + std::to_string(userInfo->age), width) << "\n";
-    std::cout << center("Height (cm): " + double_to_string(userInfo->height, precision), width) << "\n";
-    if (userInfo->gender == "female")
-    {
-        std::cout << center("Hip (cm): " + double_to_string(userInfo->hip, precision), width) << "\n";
-    }
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> queue;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+};
 
-    // Body Measurements
-    std::cout << "\n" << center("Body Measurements:", width) << "\n";
-    std::cout << center("Weight (kg): " + double_to_string(userInfo->weight, precision), width) << "\n";
-    std::cout << center("Waist (cm): " + double_to_string(userInfo->waist, precision), width) << "\n";
-    std::cout << center("Neck (cm): " + double_to_string(userInfo->neck, precision), width) << "\n";
+/**
+ * @struct MeasurementColumns
+ * @brief Column-oriented copy of the measurements the BFP/BMI kernels read.
+ *
+ * Storing each measurement in its own contiguous array lets the kernels run as straight loops
+ * the compiler can vectorize. The element type selects the compute precision.
+ */
+template <typename Real>
+struct MeasurementColumns {
+    std::vector<Real> weight;              ///< Weight in kilograms.
+    std::vector<Real> waist;               ///< Waist circumference in centimeters.
+    std::vector<Real> neck;                ///< Neck circumference in centimeters.
+    std::vector<Real> hip;                 ///< Hip circumference in centimeters.
+    std::vector<Real> height;              ///< Height in centimeters.
+    std::vector<std::int32_t> age;         ///< Age in years.
+    std::vector<Gender> gender;            ///< Gender code.
+
+    void reserve(std::size_t count);
+    void push_back(const UserInfo *user);
+    std::size_t size() const { return age.size(); }
+};
 
-    // Lifestyle
-    std::cout << "\n" << center("Lifestyle:", width) << "\n";
-    std::cout << center("Activity Level: " + userInfo->lifestyle, width) << "\n";
+template <typename Real>
+void computeBfpColumns(const MeasurementColumns<Real> &columns, BfpType bfpType,
+                       std::vector<int> &bfp, std::vector<BfpCategory> &category);
 
-    // Health Metrics
-    std::cout << "\n" << center("Health Metrics:", width) << "\n";
-    std::cout << center("Body Fat Percentage: " + double_to_string(userInfo->bfp.first, precision) + "% (" + userInfo->bfp.second + ")", width) << "\n";
-    std::cout << center("Daily Caloric Intake (calories): " + double_to_string(userInfo->daily_calories, precision), width) << "\n";
+/**
+ * @class ComputeCache
+ * @brief Memoizes computed health metrics for repeated measurement tuples.
+ *
+ * Measurements are entered to 0.5 cm and 0.1 kg, so many users share the exact same inputs.
+ * The cache is keyed by the (method, gender, age bracket, waist, neck, hip, height, weight,
+ * lifestyle) tuple and stores the BFP, its category, the daily calories and the macros. The
+ * measurements are compared exactly, never rounded, so a hit always returns the results computed
+ * for the same inputs. Age is reduced to the brackets that the BFP and calorie formulas actually
+ * distinguish, so two users in the same bracket always produce the same results.
+ *
+ * Users whose computation logs a warning (an unknown gender, or a US Navy age outside 20-79) and
+ * users with non-finite measurements are never cached, so every one of them is computed and warned about.
+ */
+class ComputeCache
+{
+    public:
+        explicit ComputeCache(std::size_t capacity = 1 << 20);
+        bool lookup(UserInfo *user, BfpType bfpType); // fills computed fields on a hit
+        void store(const UserInfo *user, BfpType bfpType);
+        void clear();
+        ComputeCacheStats getStats() const;
+        void report(const std::string &label) const;
 
-    // Macronutrient Breakdown
-    std::cout << "\n" << center("Macronutrient Breakdown (grams):", width) << "\n";
-    std::cout << center("Carbs: " + double_to_string(userInfo->carbs, precision) + "g", width) << "\n";
-    std::cout << center("Protein: " + double_to_string(userInfo->protein, precision) + "g", width) << "\n";
-    std::cout << center("Fat: " + double_to_string(userInfo->fat, precision) + "g", width) << "\n";
+    private:
+        struct Key {
+            double waist, neck, hip, height, weight;
+            std::uint8_t bfpType, gender, ageBracket, lifestyle;
+            bool operator==(const Key &other) const;
+        };
+        struct KeyHash {
+            std::size_t operator()(const Key &key) const;
+        };
+        struct Value {
+            std::pair<int, std::string> bfp;
+            int daily_calories;
+            double carbs, protein, fat;
+        };
+
+        static bool makeKey(const UserInfo *user, BfpType bfpType, Key &key);
+        static std::uint8_t ageBracket(int age);
+
+        std::unordered_map<Key, Value, KeyHash> entries;
+        std::size_t capacity;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+};
 
-    std::cout << std::endl;
-}
+/**
+ * @brief How UserInfoManager::writeToFile treats an existing file.
+ */
+enum class WriteMode {
+    Append,     ///< Add the rows after the existing content (the original behavior).
+    Rewrite     ///< Replace the file atomically: write a temporary file, then rename it over the target.
+};
 
 /**
- * @brief Deletes the user with the specified username.
- *
- * This function deletes the user with the specified username from the user information list.
+ * @class BufferedFileWriter
+ * @brief Writes text files through a large buffer, optionally replacing them atomically.
  *
- * @param username The username of the user to be deleted.
+ * Values are formatted with std::to_chars into the buffer, which is written out once it exceeds
+ * kFlushThreshold, so the number of writes is proportional to the file size, not to the number of
+ * rows. In WriteMode::Rewrite the data goes to a temporary file "<path>.tmp.<pid>.<n>", unique to
+ * the writer so concurrent rewrites of one path cannot mix their data. commit() flushes it to disk
+ * with fsync, renames it over the target and syncs the directory, so readers see either the old
+ * file or the complete new one, also after a crash. A writer destroyed without commit() removes
+ * its temporary file.
  */
-void UserInfoManager::deleteUser(std::string username)
+class BufferedFileWriter
 {
-    auto it = userInfoList.begin();
-    while (it != userInfoList.end())
-    {
-        if ((*it)->name == username)
-        {
-            break;
-        }
-        it = std::next(it,1);
-    }
+    public:
+        static const std::size_t kFlushThreshold = 1 << 20;
+
+        BufferedFileWriter(const std::string &path, WriteMode mode);
+        ~BufferedFileWriter();
+        BufferedFileWriter(const BufferedFileWriter&) = delete;
+        BufferedFileWriter &operator=(const BufferedFileWriter&) = delete;
+
+        bool isOpen() const { return file.is_open(); }
+        void append(std::string_view text) { buffer.append(text); flushIfFull(); }
+        void append(char c) { buffer += c; flushIfFull(); }
+        void appendInteger(long long value);
+        void appendNumber(double value);
+        void appendFixed(double value, int precision);
+        void appendExact(double value);
+        void appendJsonString(std::string_view text);
+        void commit();
 
-    if (it != userInfoList.end())
-    {
-        userInfoList.erase(it);
-    }
-}
+    private:
+        std::string target;
+        std::string writtenPath;
+        WriteMode mode;
+        std::ofstream file;
+        std::string buffer;
+        bool committed = false;
+        void flushIfFull() { if (buffer.size() >= kFlushThreshold) { writeBuffer(); } }
+        void writeBuffer();
+        static std::string temporaryPath(const std::string &path);
+        static bool syncToDisk(const std::string &path);
+};
 
 /**
- * @brief Displays information for a specific user based on the username.
+ * @brief Row format of user exports.
+ */
+enum class ExportFormat {
+    Csv,            ///< The positional CSV read by readFromFile.
+    CsvWithResults, ///< The positional CSV extended with the computed results and kFormulaVersion, see parseUserRecord.
+    JsonLines       ///< One JSON object per line, including computed results, read by readJsonLines.
+};
+
+/**
+ * @struct UserPage
+ * @brief One page of users returned by UserInfoManager::getPage.
  *
- * This method searches for the user with the given username in the linked list
- * and displays their information. If the user is not found, appropriate messages
- * are printed.
+ * The users are copies taken under the manager's lock, so a page stays valid and consistent while
+ * other threads recompute or delete the users it shows.
+ */
+struct UserPage {
+    std::vector<UserInfo> users;           ///< Copies of the users of the page, in list order.
+    std::string nextCursor;                ///< Cursor of the following page; empty after the last page.
+};
+
+/**
+ * @class JsonLinesReader
+ * @brief Streams user profiles out of a JSON Lines file, one flat object per line.
  *
- * @param username The username of the user to display information for.
+ * The file is read in fixed-size chunks and each line is parsed in place, so memory use does not
+ * depend on the file size and parsing allocates only when a string field outgrows the capacity of
+ * the UserInfo it is read into. Members are matched by name in any order; unknown members and
+ * nested values are skipped, and null leaves a field at its default.
  */
-void UserInfoManager::display(std::string username)
+class JsonLinesReader
 {
-    if (userInfoList.empty())
-    {
-        std::cout << "no user in list" << std::endl;
-        return;
-    }
+    public:
+        static const std::size_t kChunkSize = 1 << 20;
 
-    for (UserInfo* user : userInfoList)
-    {
-        if (user->name == username)
-        {
-            displayUser(user);
-            return;
-        }
-    }
+        explicit JsonLinesReader(const std::string &path);
+        bool isOpen() const { return file.is_open(); }
+        bool next(UserInfo &user);
+        std::size_t lineNumber() const { return lines; }
 
-    std::cout << "user not found" << std::endl;
-}
+    private:
+        std::ifstream file;
+        std::vector<char> buffer;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::size_t lines = 0;
+        bool nextLine(std::string_view &line);
+        void parse(std::string_view line, UserInfo &user) const;
+        [[noreturn]] void parseError(std::string_view line, const char *position, const char *what, char expected = 0) const;
+};
 
 /**
- * @brief Wrapper method to delete a user using UserInfoManager.
- *
- * This method acts as a simple wrapper, printing a message and calling the
- * deleteUser method in the UserInfoManager instance associated with the
- * HealthAssistant class.
+ * @class ProfileRenderer
+ * @brief Formats user profile summaries into one reusable buffer.
  *
- * @param username The username of the user to be deleted.
+ * Produces exactly the text of the original center()/double_to_string() formatting, but numbers are
+ * written with std::to_chars and each line is padded from a constant run of spaces, so rendering
+ * allocates nothing once the buffers have grown. Profiles accumulate until flush() writes them out
+ * in a single call.
  */
-void HealthAssistant::deleteUser(std::string username)
+class ProfileRenderer
 {
-    std::cout << "Deleting User by the Name: " << username << std::endl;
-    userInfoManager.deleteUser(username);
-}
+    public:
+        static const int kWidth = 60;      ///< Width every line is centered in.
+
+        void render(const UserInfo *userInfo);
+        void centered(std::string_view text);
+        void blank() { buffer += '\n'; }
+        std::size_t size() const { return buffer.size(); }
+        std::string_view text() const { return buffer; }
+        void clear() { buffer.clear(); }
+        void flush(std::ostream &out);
+
+    private:
+        std::string buffer;
+        std::string line;
+        void addNumber(double value, int precision);
+        void addInteger(int value);
+        void endLine();
+};
 
 /**
- * @brief Wrapper method to display user information using UserInfoManager.
- *
- * This method acts as a simple wrapper, checking if the specified username is
- * "all" to display information for all users, or else calling the display method
- * for the specific user in the UserInfoManager instance associated with the
- * HealthAssistant class.
+ * @struct ReportJobOptions
+ * @brief Settings of a report job run by HealthAssistant::generateReports.
+ */
+struct ReportJobOptions {
+    std::string outputDirectory = "reports";                 ///< Directory the report files are written to; created if missing.
+    std::size_t usersPerFile = 1;                            ///< 1 for one file per user, more to shard users into multi-user files.
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency()); ///< Maximum number of threads rendering and writing.
+    bool compute = true;                                     ///< Recompute BFP, calories and macros before rendering.
+};
+
+/**
+ * @struct ReportJobResult
+ * @brief Outcome and throughput of a report job.
+ */
+struct ReportJobResult {
+    std::size_t filesWritten = 0;                            ///< Report files written by this run.
+    std::size_t filesSkipped = 0;                            ///< Report files already complete from an earlier run.
+    std::size_t usersWritten = 0;                            ///< Users rendered by this run.
+    std::uintmax_t bytesWritten = 0;                         ///< Bytes written by this run.
+    double seconds = 0.0;                                    ///< Wall-clock duration of the run.
+
+    double usersPerSecond() const { return seconds > 0 ? usersWritten / seconds : 0.0; }
+};
+
+/**
+ * @class EpochReclaimer
+ * @brief Frees objects replaced by a writer once no reader can still be using them.
  *
- * @param username The username of the user to display information for, or "all" for all users.
+ * A reader pins the current epoch for as long as it dereferences published pointers. A writer
+ * first publishes the replacement of an object, then retires the old one, which advances the epoch;
+ * the old object is freed once every pinned reader has pinned the new epoch or a later one, as such
+ * a reader loaded the pointer after the replacement. Each reader writes only its own cache-line
+ * sized slot, so pinning takes no lock and does not contend with other readers.
  */
-void HealthAssistant::display(std::string username)
+class EpochReclaimer
 {
-    if (username == "all")
-    {
-        userInfoManager.displayAll();
-    }
-    else
-    {
-        userInfoManager.display(username);
-    }
-}
+    private:
+        struct alignas(64) Slot {
+            std::atomic<bool> used{ false };
+            std::atomic<std::uint64_t> epoch{ 0 };   ///< Epoch pinned by the reader in the slot, 0 when idle.
+        };
+
+    public:
+        static const std::size_t kMaxReaders = 128; ///< Readers pinned at once; further readers wait for a slot.
+
+        /**
+         * @brief Keeps the epoch pinned by a reader until it is destroyed.
+         */
+        class Guard
+        {
+            public:
+                Guard(Guard &&other) noexcept : slot(other.slot) { other.slot = nullptr; }
+                Guard &operator=(Guard &&) = delete;
+                ~Guard();
+
+            private:
+                friend class EpochReclaimer;
+                explicit Guard(Slot *slot) : slot(slot) {}
+                Slot *slot;
+        };
+
+        ~EpochReclaimer();
+        Guard pin();
+        void retire(std::function<void()> release);
+        std::size_t reclaim();
+        std::size_t pending() const;
+
+    private:
+        std::array<Slot, kMaxReaders> slots;
+        std::atomic<std::uint64_t> epoch{ 1 };
+        mutable std::mutex retiredMutex;
+        std::vector<std::pair<std::uint64_t, std::function<void()>>> retired; ///< Release functions with the epoch they were retired in.
+};
 
 /**
- * @brief Displays information for all users stored in the manager.
+ * @struct UserSegment
+ * @brief Up to UserInfoManager::kSegmentSize consecutive users of a published snapshot.
  *
- * This function iterates through the list of users and displays information for each user.
+ * The users are immutable copies shared with the manager and with every other snapshot holding
+ * them, so rebuilding a segment copies pointers, not users.
  */
-void UserInfoManager::displayAll()
-{
-    const int width = 60;
-    std::cout << center("--- BEGIN ALL USER ---", width) << std::endl << std::endl;
-    for (UserInfo* user : userInfoList)
-        displayUser(user);
-    std::cout << center("--- END ALL USER ---", width) << std::endl << std::endl;
-}
+struct UserSegment {
+    std::vector<std::shared_ptr<const UserInfo>> users;                                  ///< Users of the segment, in list order.
+    std::shared_ptr<const std::vector<std::pair<std::uint64_t, std::uint32_t>>> nameIndex; ///< (hashName(name), position) pairs sorted by hash.
+};
 
 /**
- * @brief Calculates the body fat percentage (BFP) for the user with the specified username.
+ * @struct UserSnapshot
+ * @brief One published version of the user list of a UserInfoManager.
  *
- * This function retrieves the user information by username and calculates the BFP using the US Navy method.
+ * A snapshot is never modified once published. Its users are stored in segments of
+ * UserInfoManager::kSegmentSize, and a new version shares every segment whose users did not change.
+ */
+struct UserSnapshot {
+    std::uint64_t version = 0;                                ///< Number of versions published before this one.
+    std::size_t size = 0;                                     ///< Number of users.
+    std::vector<std::shared_ptr<const UserSegment>> segments; ///< The users, in list order.
+    LiveStats liveStats;                                      ///< Statistics of the users.
+
+    std::size_t indexOf(const std::string &username) const;
+};
+
+/**
+ * @class UserSnapshotView
+ * @brief A reader's consistent view of one published UserSnapshot.
  *
- * @param username The username of the user for whom BFP needs to be calculated.
+ * The view pins its epoch, so the snapshot is not reclaimed while the view exists. It neither locks
+ * the manager nor delays writers, but it delays freeing every later replaced version, so views
+ * should be short-lived.
  */
-void USNavyMethod::getBfp(std::string username)
+class UserSnapshotView
 {
-    UserInfo *user = userInfoManager.getUserInfo(username);
-    getBfp(user);
-}
+    public:
+        UserSnapshotView(EpochReclaimer::Guard guard, const UserSnapshot *snapshot)
+            : guard(std::move(guard)), snapshot(snapshot) {}
+        std::uint64_t version() const { return snapshot->version; }
+        std::size_t size() const { return snapshot->size; }
+        const LiveStats &liveStats() const { return snapshot->liveStats; }
+        const UserInfo *find(const std::string &username) const;
+
+        /**
+         * @brief Calls a function with every user of the snapshot, in list order.
+         *
+         * @param visit Function called with a const UserInfo&.
+         */
+        template <typename Visitor>
+        void forEach(Visitor visit) const
+        {
+            for (const std::shared_ptr<const UserSegment> &segment : snapshot->segments)
+            {
+                for (const std::shared_ptr<const UserInfo> &user : segment->users)
+                {
+                    visit(*user);
+                }
+            }
+        }
+
+    private:
+        EpochReclaimer::Guard guard;
+        const UserSnapshot *snapshot;
+};
 
 /**
- * @brief Calculates the body fat percentage (BFP) for the user with the specified username.
+ * @class UserInfoManager
+ * @brief Manages user information using a linked list.
  *
- * This function retrieves the user information by username and calculates the BFP using the BMI method.
+ * This class provides functionality to manage user information through a linked list.
+ * It includes methods for adding, deleting, reading from/writing to files, and displaying
+ * user information.
  *
- * @param username The username of the user for whom BFP needs to be calculated.
+ * Every public method is safe to call from several threads. Methods changing the list or a user's
+ * computed fields hold the lock exclusively and, before returning, publish a new UserSnapshot.
+ * Lookups, displays and statistics read the latest snapshot through snapshot() and take no lock;
+ * paging and exports work on the list itself under a shared lock. Pages, getUserInfo and findUser
+ * hand out copies of the users, never the live objects. Private helpers expect the caller to hold
+ * the lock.
+ *
+ * Snapshots cost memory: every user is held twice, as the live object in userInfoList and as the
+ * immutable copy in publishedUsers that snapshots share, plus about 64 bytes of pointers and name
+ * index per user. Recomputing a user copies that one user and the pointer array and index of its
+ * segment; adding or deleting a user rebuilds the pointer arrays and indexes of the segments from
+ * its position on, without copying any user.
  */
-void BmiMethod::getBfp(std::string username)
+class UserInfoManager
 {
-    UserInfo *user = userInfoManager.getUserInfo(username);
-    getBfp(user);
-}
+    public:
+        static const std::size_t kSegmentSize = 4096; ///< Users per segment of a published snapshot.
+
+        UserInfoManager();
+        ~UserInfoManager();
+        static std::shared_ptr<UserInfoManager> shared();
+        UserSnapshotView snapshot() const;
+
+        void addUserInfo(); // adds info to list
+        void deleteUser(std::string username); // removes a user
+        void readFromFile(std::string filename); // read and populate list
+        void writeToFile(std::string filename, WriteMode mode = WriteMode::Append, ExportFormat format = ExportFormat::Csv);
+        std::vector<std::size_t> writeShards(std::string filename, std::size_t shardCount, ExportFormat format = ExportFormat::Csv);
+        void readJsonLines(std::string filename);
+        void writeJsonLines(std::string filename, WriteMode mode = WriteMode::Rewrite);
+        void display(std::string username);
+        void displayAll();
+        UserPage getPage(const std::string &cursor, std::size_t limit) const;
+        UserPage getPage(std::size_t offset, std::size_t limit) const;
+        std::string displayPage(const std::string &cursor, std::size_t limit);
+        std::string exportPage(std::string filename, const std::string &cursor, std::size_t limit,
+                               ExportFormat format, WriteMode mode = WriteMode::Append);
+
+        // Utilities
+        std::shared_ptr<const UserInfo> getUserInfo(const std::string &username) const;
+        std::optional<UserInfo> findUser(const std::string &username) const;
+        void addUserInfo(UserInfo *userInfo);
+        void addUsers(const std::vector<UserInfo*> &users);
+        bool recompute(const std::string &username, const std::function<void(UserInfo*)> &compute);
+        LiveStats getLiveStats() const;
+        void recomputeAll(const std::function<void(UserInfo*)> &compute);
+        ReportJobResult writeReports(const ReportJobOptions &options);
+
+    private:
+        mutable std::shared_mutex mutex;       ///< Shared by readers of the fields below, exclusive for writers.
+        std::vector<UserInfo*> userInfoList;
+        std::vector<std::uint64_t> userIds;    ///< Stable id of each user in userInfoList, ascending.
+        std::vector<std::shared_ptr<const UserInfo>> publishedUsers; ///< Immutable copy of each user in userInfoList, shared by the snapshots.
+        std::uint64_t nextUserId = 1;
+        LiveStats liveStats;
+        mutable EpochReclaimer epochs;
+        std::atomic<const UserSnapshot*> published;
+        std::size_t dirtyFrom = 0;             ///< Index from which the published segments are out of date.
+        std::vector<std::size_t> changedUsers; ///< Indices of the users recomputed since the last publish.
+        static std::shared_ptr<const UserSegment> buildSegment(std::vector<std::shared_ptr<const UserInfo>> users,
+                                                              const UserSegment *previous);
+        void publish();
+        void displayUser(const UserInfo *userInfo);
+        std::size_t lookupUser(const std::string &username) const;
+        void recomputeUser(UserInfo *userInfo, const std::function<void(UserInfo*)> &compute);
+        std::size_t cursorIndex(const std::string &cursor) const;
+        UserPage pageAt(std::size_t index, std::size_t limit) const;
+        void writeUsers(const std::string &filename, WriteMode mode, ExportFormat format, std::size_t begin, std::size_t end);
+        static void appendCsvRow(BufferedFileWriter &file, const UserInfo *user, bool withResults);
+        static void appendJsonRow(BufferedFileWriter &file, const UserInfo *user);
+
+        // Commandline user input
+        void getGender(UserInfo *user);
+        void getHipMeasurement(UserInfo *user);
+        void getAge(UserInfo *user);
+        void getBodyWeightMeasurement(UserInfo *user);
+        void getWaistMeasurement(UserInfo *user);
+        void getNeckMeasurement(UserInfo *user);
+        void getHeightMeasurement(UserInfo *user);
+        void getLifestyle(UserInfo *user);
+        void getName(UserInfo *user);
+    };
 
 /**
- * @brief Calculates the body fat percentage (BFP) for the specified user using the US Navy method.
- *
- * This function calculates the BFP for the specified user based on their gender, age, waist, hip, neck,
- * and height using the US Navy method.
+ * @class HealthAssistant
+ * @brief Manages health-related functionalities by wrapping around UserInfoManager.
  *
- * @param user A pointer to the UserInfo object containing the user's information.
+ * This class acts as a wrapper around UserInfoManager, providing simplified methods
+ * for managing user health information. It includes methods for getting user details,
+ * Body Fat Percentage (BFP), Daily Calories, Meal Preparation details, and more. It also
+ * acts as a bridge to UserInfoManager for operations like serialization, reading from files,
+ * deleting users, and mass loading and computing.
  */
-void USNavyMethod::getBfp(UserInfo *user)
+class HealthAssistant
 {
-    double bfp;
-    std::string category;
+    public:
+        explicit HealthAssistant(std::shared_ptr<UserInfoManager> manager = UserInfoManager::shared());
+        virtual ~HealthAssistant() {};
+        std::shared_ptr<UserInfoManager> getUserInfoManager() const { return userInfoManager; }
+        void getUserDetails(); // wrapper method that simply calls addUserInfo in class UserInfoManager
+        virtual void getBfp(std::string username) = 0;
+        void getDailyCalories(std::string username);
+        void getMealPrep(std::string username);
+        void display(std::string username); // wrapper method
+        void serialize(std::string filename, WriteMode mode = WriteMode::Append, ExportFormat format = ExportFormat::Csv); // wrapper method
+        void serialize(std::string filename, std::size_t shardCount, ExportFormat format = ExportFormat::Csv); // wrapper method
+        void readFromFile(std::string filename); // wrapper method
+        void importJsonLines(std::string filename); // wrapper method
+        void exportJsonLines(std::string filename, WriteMode mode = WriteMode::Rewrite); // wrapper method
+        std::string displayPage(std::string cursor, std::size_t limit); // wrapper method
+        std::string exportPage(std::string filename, std::string cursor, std::size_t limit,
+                               ExportFormat format, WriteMode mode = WriteMode::Append); // wrapper method
+        void deleteUser(std::string username); // wrapper method
+        void massLoadAndCompute(std::string filename);
+        void enableComputeCache(bool enabled);
+        ComputeCacheStats getComputeCacheStats() const;
+        LiveStats getLiveStats() const; // wrapper method
+        ReportJobResult generateReports(const ReportJobOptions &options = ReportJobOptions());
+    protected:
+        std::shared_ptr<UserInfoManager> userInfoManager;
+    private:
+        std::unique_ptr<ComputeCache> computeCache;
+        virtual BfpType getBfpType() const = 0;
+        virtual void getBfp(UserInfo *user) = 0;
+        void getDailyCalories(UserInfo *user);
+        void getMealPrep(UserInfo *user);
+};
 
-    if (user->gender == "female")
-    {
+/**
+ * @brief The USNavyMethod class represents a health assistant that implements the US Navy method
+ * for calculating body fat percentage (BFP).
+ *
+ * This class inherits from the HealthAssistant class and provides implementations for calculating
+ * BFP using the US Navy method.
+ */
+class USNavyMethod : public HealthAssistant
+{
+    public:
+        using HealthAssistant::HealthAssistant;
+        void getBfp(std::string username) override;
+    private:
+        BfpType getBfpType() const override { return BfpType::USNavyMethod; }
+        void getBfp(UserInfo *user) override;
+};
+
+/**
+ * @brief The BmiMethod class represents a health assistant that implements the BMI method
+ * for calculating body fat percentage (BFP).
+ *
+ * This class inherits from the HealthAssistant class and provides implementations for calculating
+ * BFP using the BMI method.
+ */
+class BmiMethod : public HealthAssistant
+{
+    public:
+        using HealthAssistant::HealthAssistant;
+        void getBfp(std::string username) override;
+    private:
+        BfpType getBfpType() const override { return BfpType::BmiMethod; }
+        void getBfp(UserInfo *user) override;
+};
+
+/**
+ * @brief The UserStats class represents a utility class for managing and retrieving user statistics.
+ *
+ * This class provides methods to retrieve information about healthy and unfit users based on different
+ * criteria and methods, as well as to compute full statistics for all users.
+ */
+class UserStats
+{
+    public:
+        std::vector<std::string> GetHealthyUsers(std::string method, std::string gender);
+        std::vector<std::string> GetHealthyUsers(std::string method);
+        std::vector<std::string> GetUnfitUsers(std::string method, std::string gender);
+        std::vector<std::string> GetUnfitUsers(std::string method);
+        RowSet SelectUsers(std::string method, std::vector<Condition> where);
+        RowSet SelectUsers(std::string method, const FilterProgram &filter);
+        void GetFullStats();
+        void enableComputeCache(bool enabled);
+        ComputeCacheStats getComputeCacheStats() const;
+        void setComputePrecision(ComputePrecision precision);
+        void setThreadCount(unsigned count);
+        void clearDatasetCache();
+        std::vector<double> GetAggregates(std::string method, const AggregateQuery &query);
+        std::vector<GroupStats> GetCrossTab(std::string method, std::vector<Condition> where = {});
+        std::vector<CohortDistribution> GetDistribution(std::string method, Column column, std::size_t buckets = 10);
+        std::vector<std::string> Query(std::string method, std::string expression);
+        std::vector<std::string> Query(std::string method, const FilterProgram &filter);
+        std::vector<RankedUser> GetTopUsers(std::string method, Column column, std::size_t k, bool highest = true, std::string filter = "");
+        std::vector<std::vector<RankedUser>> GetTopUsersPerLifestyle(std::string method, Column column, std::size_t k, bool highest = true, std::string filter = "");
+        ApproximateProportion EstimateProportion(std::string method, std::vector<Condition> where, std::size_t sampleSize = 10000);
+        ApproximateStats GetApproximateStats(std::string method = "all", std::size_t sampleSize = 10000);
+        MethodAgreement CompareMethods(const std::function<void(const JoinedUser&)> &visit = nullptr);
+        void ExportColumnar(std::string method, const std::string &path, std::size_t rowGroupSize = 16384,
+                            std::optional<Column> sortBy = Column::Age);
+        std::shared_ptr<const UserTable> LoadColumnar(const std::string &path, const std::vector<Condition> &where = {},
+                                                      ColumnarScanStats *scan = nullptr);
+    private:
+        /**
+         * @brief A loaded and computed data file, valid as long as the file keeps the same size and mtime.
+         */
+        struct CachedDataset {
+            std::uintmax_t fileSize;
+            std::filesystem::file_time_type modified;
+            std::shared_ptr<const UserTable> table;
+        };
+
+        std::unique_ptr<ComputeCache> computeCache;
+        ComputePrecision computePrecision = ComputePrecision::Double;
+        unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+        std::map<std::pair<std::string, BfpType>, CachedDataset> datasetCache;
+        std::shared_ptr<const UserTable> loadTable(const std::string &filename, BfpType bfpType);
+        std::vector<std::shared_ptr<const UserTable>> loadTables(const std::string &method);
+        std::vector<std::uint32_t> selectRows(const UserTable &table, const std::vector<Condition> &where);
+        std::vector<std::vector<RankedUser>> topUsers(const std::string &method, Column column, std::size_t k, bool highest,
+                                                      const std::string &filter, bool perLifestyle);
+        std::shared_ptr<std::vector<UserInfo*>> massLoadAndCompute(std::string filename, BfpType bfpType);
+        void usNavyMethod(UserInfo *user);
+        void bmiMethod(UserInfo *user);
+        void getDailyCalories(UserInfo *user);
+        void getMealPrep(UserInfo *user);
+};
+
+/* -- Main Program -- */
+int main(int argc, char* argv[])
+{
+    HealthAssistant* ha = new USNavyMethod();
+    std::string userInput;
+    // Loop until the user inputs "exit"
+    while (true)
+    {
+        // Get user details
+        ha->getUserDetails();
+        // Ask for user input
+        std::cout << "Enter 'exit' to quit, or press Enter to continue:";
+        std::getline(std::cin, userInput);
+        std::cout << std::endl;
+        // Check if the user wants to exit
+        if (userInput == "exit")
+        {
+            break; // exit the loop
+        }
+    }
+
+    std::cout << "USNavyMethod before calculation" << std::endl;
+    ha->display("all");
+    ha->getBfp("john");
+    ha->getDailyCalories("john");
+    ha->getMealPrep("john");
+    ha->serialize("us_user_data.csv");
+    std::cout << "USNavyMethod after calculation" << std::endl;
+    ha->display("all"); // only john's information is computed at this point
+    delete ha;
+
+    ha = new BmiMethod();
+    // Loop until the user inputs "exit"
+    while (true)
+    {
+        // Get user details
+        ha->getUserDetails();
+        // Ask for user input
+        std::cout << "Enter 'exit' to quit, or press Enter to continue:";
+        std::getline(std::cin, userInput);
+        // Check if the user wants to exit
+        if (userInput == "exit")
+        {
+            break; // Exit the loop
+        }
+    }
+
+    std::cout << "BmiMethod before calculation" << std::endl;
+    ha->display("all");
+    ha->getBfp("john");
+    ha->getDailyCalories("john");
+    ha->getMealPrep("john");
+    ha->deleteUser("jack"); // assuming we have a user jack
+    std::cout << "BmiMethod after calculation" << std::endl;
+    ha->display("all"); // should display all except for jack
+    ha->serialize("bmi_user_data.csv");
+    delete ha;
+
+    ha = new USNavyMethod();
+    ha->massLoadAndCompute("us_user_data.csv");
+    std::cout << "USNavyMethod after massLoadAndCompute" << std::endl;
+    ha->display("all");
+    delete ha;
+    ha = new BmiMethod();
+    ha->massLoadAndCompute("bmi_user_data.csv");
+    std::cout << "BmiMethod after massLoadAndCompute" << std::endl;
+    ha->display("all");
+    delete ha;
+
+    UserStats stat;
+
+    stat.GetHealthyUsers("bmi", "female");
+    // stat.GetHealthyUsers("bmi", "male"); // extra test
+    // stat.GetHealthyUsers("USArmy", "female"); // extra test
+    // stat.GetHealthyUsers("USArmy", "male"); // extra test
+    stat.GetHealthyUsers("all");
+
+    // stat.GetUnfitUsers("bmi", "female"); // extra test
+    // stat.GetUnfitUsers("bmi", "male"); // extra test
+    // stat.GetUnfitUsers("USArmy", "female"); // extra test
+    stat.GetUnfitUsers("USArmy", "male");
+    // stat.GetUnfitUsers("all"); // extra test
+    stat.GetFullStats();
+    return 0;
+}
+
+/* -- Function Definitions -- */
+
+/**
+ * @brief Adds user information to the linked list maintained by UserInfoManager.
+ *
+ * This method creates a new UserInfo object, populates it with user details
+ * through various helper methods, and adds it to the end of the linked list.
+ * If the list is empty, the new UserInfo object becomes the first element;
+ * otherwise, it is appended to the end of the existing list.
+ */
+void UserInfoManager::addUserInfo()
+{
+    UserInfo *userInfo = new UserInfo;
+
+    getName(userInfo);
+    getGender(userInfo);
+    getHipMeasurement(userInfo);
+    getAge(userInfo);
+    getBodyWeightMeasurement(userInfo);
+    getWaistMeasurement(userInfo);
+    getNeckMeasurement(userInfo);
+    getHeightMeasurement(userInfo);
+    getLifestyle(userInfo);
+    addUserInfo(userInfo);
+}
+
+/**
+ * @brief Constructs an empty manager and publishes its first, empty snapshot.
+ */
+UserInfoManager::UserInfoManager()
+    : published(new UserSnapshot)
+{
+}
+
+/**
+ * @brief Frees the published snapshot; no reader may still be using the manager.
+ */
+UserInfoManager::~UserInfoManager()
+{
+    delete published.load();
+}
+
+/**
+ * @brief Returns the latest published snapshot of the users, without taking a lock.
+ *
+ * Usage example:
+ * UserSnapshotView view = manager.snapshot();
+ * view.forEach([](const UserInfo &user) { ... });
+ *
+ * Every method changing the manager has published its changes before returning, so a thread sees
+ * its own writes, and other threads see each writer's changes all at once.
+ *
+ * @return UserSnapshotView The snapshot, kept alive until the view is destroyed.
+ */
+UserSnapshotView UserInfoManager::snapshot() const
+{
+    EpochReclaimer::Guard guard = epochs.pin();
+    return UserSnapshotView(std::move(guard), published.load());
+}
+
+/**
+ * @brief Publishes a new snapshot of the list; the caller holds the lock exclusively.
+ *
+ * Recomputed users get a new immutable copy. Segments from dirtyFrom onward and segments holding a
+ * recomputed user are rebuilt from publishedUsers, copying pointers only; all others are shared with
+ * the previous snapshot, which is retired to the EpochReclaimer and freed once the readers still
+ * using it are done.
+ */
+void UserInfoManager::publish()
+{
+    const UserSnapshot *previous = published.load();
+    std::unique_ptr<UserSnapshot> next(new UserSnapshot);
+    next->version = previous->version + 1;
+    next->size = userInfoList.size();
+    next->liveStats = liveStats;
+
+    const std::size_t segmentCount = (userInfoList.size() + kSegmentSize - 1) / kSegmentSize;
+    std::vector<bool> rebuild(segmentCount, false);
+    for (std::size_t segment = dirtyFrom / kSegmentSize; segment < segmentCount; segment++)
+    {
+        rebuild[segment] = true;
+    }
+    for (std::size_t i : changedUsers)
+    {
+        publishedUsers[i] = std::make_shared<const UserInfo>(*userInfoList[i]);
+        rebuild[i / kSegmentSize] = true;
+    }
+
+    next->segments.reserve(segmentCount);
+    for (std::size_t segment = 0; segment < segmentCount; segment++)
+    {
+        if (!rebuild[segment] && segment < previous->segments.size())
+        {
+            next->segments.push_back(previous->segments[segment]);
+            continue;
+        }
+
+        std::size_t begin = segment * kSegmentSize;
+        std::size_t end = std::min(publishedUsers.size(), begin + kSegmentSize);
+        std::vector<std::shared_ptr<const UserInfo>> users(publishedUsers.begin() + begin, publishedUsers.begin() + end);
+        const UserSegment *old = segment < previous->segments.size() ? previous->segments[segment].get() : nullptr;
+        next->segments.push_back(buildSegment(std::move(users), old));
+    }
+
+    published.store(next.release());
+    epochs.retire([previous] { delete previous; });
+    dirtyFrom = std::numeric_limits<std::size_t>::max();
+    changedUsers.clear();
+}
+
+/**
+ * @brief Builds a published segment, reusing the name index of the segment it replaces when possible.
+ *
+ * @param users The users of the segment, in list order.
+ * @param previous The segment at the same position in the previous snapshot, or nullptr.
+ * @return std::shared_ptr<const UserSegment> The new segment.
+ */
+std::shared_ptr<const UserSegment> UserInfoManager::buildSegment(std::vector<std::shared_ptr<const UserInfo>> users,
+                                                                const UserSegment *previous)
+{
+    std::shared_ptr<UserSegment> segment = std::make_shared<UserSegment>();
+    segment->users = std::move(users);
+
+    bool sameNames = previous != nullptr && previous->users.size() == segment->users.size();
+    for (std::size_t i = 0; sameNames && i < segment->users.size(); i++)
+    {
+        sameNames = segment->users[i] == previous->users[i] || segment->users[i]->name == previous->users[i]->name;
+    }
+    if (sameNames)
+    {
+        segment->nameIndex = previous->nameIndex;
+        return segment;
+    }
+
+    std::shared_ptr<std::vector<std::pair<std::uint64_t, std::uint32_t>>> nameIndex =
+        std::make_shared<std::vector<std::pair<std::uint64_t, std::uint32_t>>>();
+    nameIndex->reserve(segment->users.size());
+    for (std::size_t i = 0; i < segment->users.size(); i++)
+    {
+        nameIndex->emplace_back(hashName(segment->users[i]->name), static_cast<std::uint32_t>(i));
+    }
+    std::sort(nameIndex->begin(), nameIndex->end());
+    segment->nameIndex = std::move(nameIndex);
+    return segment;
+}
+
+/**
+ * @brief Returns the manager used by every HealthAssistant constructed without one.
+ *
+ * @return std::shared_ptr<UserInfoManager> The process-wide manager, created on first use.
+ */
+std::shared_ptr<UserInfoManager> UserInfoManager::shared()
+{
+    static std::shared_ptr<UserInfoManager> manager = std::make_shared<UserInfoManager>();
+    return manager;
+}
+
+/**
+ * @brief Constructs a health assistant working on a user manager.
+ *
+ * Assistants constructed with the same manager see the same users, which is how the BMI and US Navy
+ * assistants share their list by default. Pass a separate manager to give an assistant its own users:
+ *
+ * BmiMethod bmi(std::make_shared<UserInfoManager>());
+ * USNavyMethod usNavy(bmi.getUserInfoManager());
+ *
+ * @param manager The manager holding the users; UserInfoManager::shared() by default.
+ */
+HealthAssistant::HealthAssistant(std::shared_ptr<UserInfoManager> manager)
+    : userInfoManager(std::move(manager))
+{
+}
+
+/**
+ * @brief Wrapper method to add user information using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, calling the addUserInfo method in the
+ * UserInfoManager instance associated with the HealthAssistant class.
+ */
+void HealthAssistant::getUserDetails()
+{
+    userInfoManager->addUserInfo();
+}
+
+/**
+ * @brief Helper function for centering text within a given width
+ *
+ * @param input Title of the display information
+ * @param width Width for centering
+ * @return std::string
+ */
+std::string center(const std::string &input, int width)
+{
+    int inputLength = input.length();
+    int diff = width - inputLength;
+    int pad1 = diff / 2;
+    int pad2 = diff - pad1;
+
+    if (width < inputLength)
+    {
+        return input;
+    }
+
+    return std::string(pad1, ' ') + input + std::string(pad2, ' ');
+}
+
+/**
+ * @brief Converts a double value to a string with fixed precision.
+ *
+ * @param input The double precision floating-point number to be converted into a string.
+ * @return std::string A string representation of the input number, formatted to two decimal places.
+ */
+std::string double_to_string(double input, int precision)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(precision) << input;
+    return ss.str();
+}
+
+/**
+ * @brief Displays a summary of the user's profile.
+ *
+ * This function presents a comprehensive overview of the user's input data and calculated results,
+ * including personal details, body measurements, lifestyle information, body fat percentage,
+ * recommended daily caloric intake, and macronutrient needs. The output is formatted to enhance
+ * readability and provide a clear understanding of the user's health and nutritional profile.
+ */
+void UserInfoManager::displayUser(const UserInfo *userInfo)
+{
+    ProfileRenderer renderer;
+    renderer.render(userInfo);
+    renderer.flush(std::cout);
+}
+
+/**
+ * @brief Deletes the user with the specified username.
+ *
+ * This function deletes the user with the specified username from the user information list.
+ *
+ * @param username The username of the user to be deleted.
+ */
+void UserInfoManager::deleteUser(std::string username)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = userInfoList.begin() + published.load()->indexOf(username);
+
+    if (it != userInfoList.end())
+    {
+        liveStats.account(*it, -1);
+        dirtyFrom = std::min<std::size_t>(dirtyFrom, it - userInfoList.begin());
+        userIds.erase(userIds.begin() + (it - userInfoList.begin()));
+        publishedUsers.erase(publishedUsers.begin() + (it - userInfoList.begin()));
+        userInfoList.erase(it);
+        publish();
+    }
+}
+
+/**
+ * @brief Displays information for a specific user based on the username.
+ *
+ * This method searches for the user with the given username in the linked list
+ * and displays their information. If the user is not found, appropriate messages
+ * are printed.
+ *
+ * @param username The username of the user to display information for.
+ */
+void UserInfoManager::display(std::string username)
+{
+    UserSnapshotView view = snapshot();
+    if (view.size() == 0)
+    {
+        std::cout << "no user in list" << std::endl;
+        return;
+    }
+
+    if (const UserInfo *user = view.find(username))
+    {
+        displayUser(user);
+        return;
+    }
+
+    std::cout << "user not found" << std::endl;
+}
+
+/**
+ * @brief Wrapper method to delete a user using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, printing a message and calling the
+ * deleteUser method in the UserInfoManager instance associated with the
+ * HealthAssistant class.
+ *
+ * @param username The username of the user to be deleted.
+ */
+void HealthAssistant::deleteUser(std::string username)
+{
+    std::cout << "Deleting User by the Name: " << username << std::endl;
+    userInfoManager->deleteUser(username);
+}
+
+/**
+ * @brief Wrapper method to display user information using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, checking if the specified username is
+ * "all" to display information for all users, or else calling the display method
+ * for the specific user in the UserInfoManager instance associated with the
+ * HealthAssistant class.
+ *
+ * @param username The username of the user to display information for, or "all" for all users.
+ */
+void HealthAssistant::display(std::string username)
+{
+    if (username == "all")
+    {
+        userInfoManager->displayAll();
+    }
+    else
+    {
+        userInfoManager->display(username);
+    }
+}
+
+/**
+ * @brief Displays information for all users stored in the manager.
+ *
+ * This function iterates through the list of users and displays information for each user.
+ * Profiles are rendered into one buffer that is written out about every megabyte.
+ */
+void UserInfoManager::displayAll()
+{
+    UserSnapshotView view = snapshot();
+    const std::size_t flushThreshold = 1 << 20;
+    ProfileRenderer renderer;
+    renderer.centered("--- BEGIN ALL USER ---");
+    renderer.blank();
+    view.forEach([&](const UserInfo &user) {
+        renderer.render(&user);
+        if (renderer.size() >= flushThreshold)
+        {
+            renderer.flush(std::cout);
+        }
+    });
+    renderer.centered("--- END ALL USER ---");
+    renderer.blank();
+    renderer.flush(std::cout);
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for the user with the specified username.
+ *
+ * This function retrieves the user information by username and calculates the BFP using the US Navy method.
+ *
+ * @param username The username of the user for whom BFP needs to be calculated.
+ */
+void USNavyMethod::getBfp(std::string username)
+{
+    userInfoManager->recompute(username, [this](UserInfo *user) { getBfp(user); });
+    Logger::shared().flush(); // print any warning before the caller's next prompt
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for the user with the specified username.
+ *
+ * This function retrieves the user information by username and calculates the BFP using the BMI method.
+ *
+ * @param username The username of the user for whom BFP needs to be calculated.
+ */
+void BmiMethod::getBfp(std::string username)
+{
+    userInfoManager->recompute(username, [this](UserInfo *user) { getBfp(user); });
+    Logger::shared().flush(); // print any warning before the caller's next prompt
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for the specified user using the US Navy method.
+ *
+ * This function calculates the BFP for the specified user based on their gender, age, waist, hip, neck,
+ * and height using the US Navy method.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void USNavyMethod::getBfp(UserInfo *user)
+{
+    double bfp = 0.0;
+    std::string category;
+
+    if (user->gender == "female")
+    {
+        bfp = (495.0 / (1.29579 - 0.35004 * log10(user->waist + user->hip - user->neck) + 0.22100 * log10(user->height))) - 450.0;
+
+        if (user->age >= 20 && user->age <= 39)
+        {
+            if (bfp < 21)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 33)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 39)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 40 && user->age <= 59)
+        {
+            if (bfp < 23)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 34)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 40)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 60 && user->age <= 79)
+        {
+            if (bfp < 24)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 36)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 42)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else
+        {
+            Logger::shared().log(LogLevel::Warn, "The body fat category cannot be determined because you are outside of the permitted age range.");
+        }
+    }
+    else if (user->gender == "male")
+    {
+        bfp = (495.0 / (1.0324 - 0.19077 * log10(user->waist - user->neck) + 0.15456 * log10(user->height))) - 450.0;
+        if (user->age >= 20 && user->age <= 39)
+        {
+            if (bfp < 8)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 20)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 25)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 40 && user->age <= 59)
+        {
+            if (bfp < 11)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 22)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 28)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 60 && user->age <= 79)
+        {
+            if (bfp < 13)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 25)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 30)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else
+        {
+            Logger::shared().log(LogLevel::Warn, "The body fat category cannot be determined because you are outside of the permitted age range.");
+        }
+    }
+
+    // Return Body Fat Percentage (BFP) and category as a pair; genders without a formula stay uncomputed
+    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    user->bfpType = user->gender == "female" || user->gender == "male" ? std::optional<BfpType>(BfpType::USNavyMethod) : std::nullopt;
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for the specified user using the BMI method.
+ *
+ * This function calculates the BFP for the specified user based on their weight and height using the BMI method.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void BmiMethod::getBfp(UserInfo *user)
+{
+    double bfp = 0.0;
+    std::string category;
+
+    bfp = (user->weight*100*100)/(user->height*user->height);
+
+    if (bfp < 18.5)
+    {
+        category = "Bmi: Low";
+    }
+    else if (bfp < 25)
+    {
+        category = "Bmi: Normal";
+    }
+    else if (bfp < 30)
+    {
+        category = "Bmi: High";
+    }
+    else
+    {
+        category = "Bmi: Very High";
+    }
+
+    // Return Body Fat Percentage (BFP) and category as a pair
+    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    user->bfpType = BfpType::BmiMethod;
+}
+
+/**
+ * @brief Wrapper method to calculate the daily calorie intake using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, retrieving the UserInfo object for the specified username
+ * and then calling the getDailyCalories method in the UserInfoManager instance, passing the UserInfo object as an argument.
+ *
+ * @param username The username of the user for whom the daily calorie intake is calculated.
+ */
+void HealthAssistant::getDailyCalories(std::string username)
+{
+    userInfoManager->recompute(username, [this](UserInfo *user) { getDailyCalories(user); });
+    Logger::shared().flush(); // print any warning before the caller's next prompt
+}
+
+/**
+ * @brief Calculates the recommended daily caloric intake based on age, gender, and lifestyle.
+ *
+ * This function estimates the daily caloric intake needed for an individual based on their age, gender,
+ * and lifestyle activity level. The caloric intake recommendations are differentiated by age ranges
+ * and activity levels ('sedentary', 'moderate', 'active') for both male and female genders.
+ * The calculated intake aims to maintain the individual's current weight, assuming their reported
+ * activity level.
+ *
+ * The activity levels are defined as follows:
+ * - 'Sedentary': little or no exercise
+ * - 'Moderate': light exercise/sports 1-3 days a week
+ * - 'Active': hard exercise/sports 3-5 days a week
+ *
+ * Age is considered in three brackets:
+ * - 19-30 years
+ * - 31-50 years
+ * - Over 50 years
+ *
+ * The calorie recommendations are based on general guidelines and may need adjustments for
+ * individual metabolism, health conditions, and specific weight goals.
+ * @param user Pointer to the UserInfo object for whom the daily calorie intake is calculated.
+ */
+void HealthAssistant::getDailyCalories(UserInfo *user)
+{
+    int calories = 0;
+
+    if (user->gender == "male")
+    {
+        if (user->age >= 19 && user->age <= 30)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2400;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2800;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 3000;
+            }
+        }
+        else if (user->age >= 31 && user->age <= 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2200;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2600;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 3000;
+            }
+        }
+        else if (user->age > 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2400;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2800;
+            }
+        }
+    }
+    else if (user->gender == "female")
+    {
+        if (user->age >= 19 && user->age <= 30)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2200;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2400;
+            }
+        }
+        else if (user->age >= 31 && user->age <= 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 1800;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2200;
+            }
+        }
+        else if (user->age > 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 1600;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 1800;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2200;
+            }
+        }
+    } else {
+        Logger::shared().log(LogLevel::Warn, "This is ackward, your intake calarie wasn't able to be processed");
+        calories = 0;
+    }
+
+    user->daily_calories = calories;
+}
+
+/**
+ * @brief Retrieves the UserInfo object for a specified username.
+ *
+ * This method traverses the linked list to find the UserInfo object corresponding to the given username.
+ * If the username is not found or the linked list is empty, error messages are displayed, and nullptr is returned.
+ * The user returned is the immutable copy shared with the published snapshots, so it stays valid and
+ * unchanged after the user is recomputed or deleted; use recompute(username, compute) to change a user.
+ *
+ * @param username The username of the user for whom the UserInfo object is retrieved.
+ * @return std::shared_ptr<const UserInfo> The user if found, otherwise nullptr.
+ */
+std::shared_ptr<const UserInfo> UserInfoManager::getUserInfo(const std::string &username) const
+{
+    std::shared_ptr<const UserInfo> user;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::size_t index = lookupUser(username);
+        if (index < userInfoList.size())
+        {
+            user = publishedUsers[index];
+        }
+    }
+    Logger::shared().flush(); // print any warning before the caller's next prompt
+    return user;
+}
+
+/**
+ * @brief Returns a copy of the UserInfo object for a specified username.
+ *
+ * The copy is read from the latest published snapshot without taking the lock, so it is
+ * consistent even while other threads add, delete or recompute users.
+ *
+ * @param username The username of the user to look up.
+ * @return std::optional<UserInfo> A copy of the user, or std::nullopt if there is no such user.
+ */
+std::optional<UserInfo> UserInfoManager::findUser(const std::string &username) const
+{
+    UserSnapshotView view = snapshot();
+    const UserInfo *user = view.find(username);
+    if (user == nullptr)
+    {
+        return std::nullopt;
+    }
+    return *user;
+}
+
+/**
+ * @brief Finds the user with a username, logging a warning if there is none.
+ *
+ * Every change is published before the lock is released, so the latest snapshot lists the same
+ * users at the same positions as userInfoList and its name indexes answer the lookup.
+ *
+ * @param username The username of the user to look up.
+ * @return std::size_t The index of the user in userInfoList, or userInfoList.size() if not found.
+ */
+std::size_t UserInfoManager::lookupUser(const std::string &username) const
+{
+    if (userInfoList.empty())
+    {
+        Logger::shared().log(LogLevel::Warn, "no user in list");
+        return 0;
+    }
+
+    std::size_t index = published.load()->indexOf(username);
+    if (index == userInfoList.size())
+    {
+        Logger::shared().log(LogLevel::Warn, "user not found: " + username);
+    }
+    return index;
+}
+
+/**
+ * @brief Wrapper method to calculate the recommended macronutrient distribution for meal preparation using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, retrieving the UserInfo object for the specified username
+ * and then calling the getMealPrep method in the UserInfoManager instance, passing the UserInfo object as an argument.
+ *
+ * @param username The username of the user for whom the macronutrient distribution is calculated.
+ */
+void HealthAssistant::getMealPrep(std::string username)
+{
+    userInfoManager->recompute(username, [this](UserInfo *user) { getMealPrep(user); });
+    Logger::shared().flush(); // print any warning before the caller's next prompt
+}
+
+/**
+ * @brief Calculates the required amounts of macronutrients based on a set caloric intake, adhering to standard nutritional guidelines.
+ *
+ * This function assists in meal planning by breaking down the total daily caloric intake into the recommended proportions of macronutrients:
+ * 50% from carbohydrates, 30% from protein, and 20% from fat. It utilizes the caloric values of 4 calories per gram for both carbohydrates
+ * and protein, and 9 calories per gram for fat, to calculate the necessary grams of each macronutrient needed to meet the specified caloric intake.
+ * The calculated amounts are then returned via reference parameters, allowing for direct integration into meal planning or dietary adjustments.
+ *
+ * The function supports customization of the caloric intake, making it a versatile tool for dietary planning across a range of nutritional needs
+ * and goals. Whether for weight management, athletic performance, or general health, this function provides a foundational step in constructing
+ * a balanced diet.
+ * @param user Pointer to the UserInfo object for whom the meal prep is calculated.
+ */
+void HealthAssistant::getMealPrep(UserInfo *user)
+{
+    // Define the percentage of total calories for each macronutrient
+    const double carbs_percentage = 0.50;
+    const double protein_percentage = 0.30;
+    const double fat_percentage = 0.20;
+
+    // Calculate the calories for each macronutrient
+    double carbs_calories = user->daily_calories * carbs_percentage;
+    double protein_calories = user->daily_calories * protein_percentage;
+    double fat_calories = user->daily_calories * fat_percentage;
+
+    // Calculate the grams for each macronutrient
+    user->carbs = carbs_calories / 4.0;
+    user->protein = protein_calories / 4.0;
+    user->fat = fat_calories / 9.0;
+}
+
+/**
+ * @brief Serializes user data to a CSV file.
+ *
+ * Usage example:
+ * serialize("userData.csv");
+ *
+ * CSV file example after multiple runs:
+ * male,28,72,91,43,,172,sedentary
+ * female,23,61,68,36,70,170,moderate
+ *
+ * Rows are formatted into a BufferedFileWriter, producing the same text as the previous ostream
+ * formatting (6 significant digits, hip with 1 decimal) with one write per megabyte instead of one
+ * flush per user.
+ *
+ * @param filename The name (and path, if necessary) of the CSV file to which user data will be written.
+ * @param mode WriteMode::Append adds the users to the file, WriteMode::Rewrite atomically replaces it.
+ */
+void UserInfoManager::writeToFile(std::string filename, WriteMode mode, ExportFormat format)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    writeUsers(filename, mode, format, 0, userInfoList.size());
+}
+
+/**
+ * @brief Writes a range of the user list to a file in one of the export formats.
+ *
+ * @param filename The file written.
+ * @param mode Whether to append to the file or atomically replace it.
+ * @param format The format of the rows.
+ * @param begin Index of the first user written.
+ * @param end Index one past the last user written.
+ */
+void UserInfoManager::writeUsers(const std::string &filename, WriteMode mode, ExportFormat format, std::size_t begin, std::size_t end)
+{
+    BufferedFileWriter file(filename, mode);
+    if (!file.isOpen())
+    {
+        Logger::shared().log(LogLevel::Error, "Error opening file: " + filename);
+        Logger::shared().flush();
+        return;
+    }
+
+    for (std::size_t i = begin; i < end; i++)
+    {
+        if (format == ExportFormat::Csv || format == ExportFormat::CsvWithResults)
+        {
+            appendCsvRow(file, userInfoList[i], format == ExportFormat::CsvWithResults);
+        }
+        else
+        {
+            appendJsonRow(file, userInfoList[i]);
+        }
+    }
+
+    try
+    {
+        file.commit();
+    }
+    catch (const std::exception &e)
+    {
+        Logger::shared().log(LogLevel::Error, "Error writing file: " + filename + " (" + e.what() + ")");
+        Logger::shared().flush();
+    }
+}
+
+/**
+ * @brief Appends a user as a CSV row: name,gender,age,weight,waist,neck,hip,height,lifestyle.
+ *
+ * Extended rows add method,formula_version,bfp,category,daily_calories,carbs,protein,fat. The
+ * method is taken from the category label and left empty when the user has no category, in which
+ * case loaders recompute the row. Results are written with round-trip precision.
+ *
+ * @param file The writer appended to.
+ * @param user The user written.
+ * @param withResults Whether to write the extended row.
+ */
+void UserInfoManager::appendCsvRow(BufferedFileWriter &file, const UserInfo *user, bool withResults)
+{
+    file.append(user->name);
+    file.append(',');
+    file.append(user->gender);
+    file.append(',');
+    file.appendInteger(user->age);
+    file.append(',');
+    file.appendNumber(user->weight);
+    file.append(',');
+    file.appendNumber(user->waist);
+    file.append(',');
+    file.appendNumber(user->neck);
+    file.append(',');
+    if (user->gender == "female")
+    {
+        file.appendFixed(user->hip, 1);
+    }
+    file.append(',');
+    file.appendNumber(user->height);
+    file.append(',');
+    file.append(user->lifestyle);
+    if (withResults)
+    {
+        file.append(!user->bfpType ? ",," : *user->bfpType == BfpType::BmiMethod ? ",bmi," : ",usnavy,");
+        file.appendInteger(kFormulaVersion);
+        file.append(',');
+        file.appendInteger(user->bfp.first);
+        file.append(',');
+        file.append(user->bfp.second);
+        file.append(',');
+        file.appendInteger(user->daily_calories);
+        file.append(',');
+        file.appendExact(user->carbs);
+        file.append(',');
+        file.appendExact(user->protein);
+        file.append(',');
+        file.appendExact(user->fat);
+    }
+    file.append('\n');
+}
+
+/**
+ * @brief Wrapper method to serialize user information to a file using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, calling the writeToFile method in the UserInfoManager instance associated with the
+ * HealthAssistant class, passing the specified filename as an argument.
+ *
+ * @param filename The name of the file to which user information is serialized.
+ * @param mode WriteMode::Append adds the users to the file, WriteMode::Rewrite atomically replaces it.
+ */
+void HealthAssistant::serialize(std::string filename, WriteMode mode, ExportFormat format)
+{
+    userInfoManager->writeToFile(filename, mode, format);
+}
+
+/**
+ * @brief Wrapper method to serialize user information into hash-partitioned shard files using UserInfoManager.
+ *
+ * Usage example:
+ * serialize("users.csv", 8); // users-00000-of-00008.csv ... users-00007-of-00008.csv and users.manifest
+ *
+ * @param filename Base name of the shard files and the manifest.
+ * @param shardCount Number of shard files.
+ * @param format Row format of the shard files.
+ */
+void HealthAssistant::serialize(std::string filename, std::size_t shardCount, ExportFormat format)
+{
+    userInfoManager->writeShards(filename, shardCount, format);
+}
+
+/**
+ * @brief Reads user data from a specified CSV file and stores it in a vector.
+ *
+ * This function opens a CSV file with the given filename and reads its contents line by line,
+ * parsing each line into a User object. Each line in the CSV file represents a single user's data,
+ * structured in the following order: Gender, Age, Weight, Waist, Neck, Hip (optional for females),
+ * Height, Lifestyle. The function handles the conditional presence of the hip measurement by checking
+ * if the relevant token is empty and assigns a default value of 0.0 if it is absent, ensuring compatibility
+ * with male user records where this measurement is not applicable.
+ *
+ * Assumptions:
+ * - The CSV file is located in the same local folder as the program.
+ * - The file format is consistent with the expected structure.
+ *  - name,gender,age,weight,waist,neck,hip,height,lifestyle
+ *  - no empty line except the last line which must be empty.
+ *
+ * @param filename The name of the CSV file from which to read user data.
+ * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ */
+void UserInfoManager::readFromFile(std::string filename)
+{
+    std::ifstream file(filename);
+    std::string line;
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
+        return;
+    }
+
+    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
+    if (ifs.tellg() == 0)
+    {
+        throw std::runtime_error("File is empty: " + filename);
+    }
+
+    std::vector<UserInfo*> batch;
+    try
+    {
+        while (getline(file, line))
+        {
+            UserInfo *user = new UserInfo;
+            parseUserRecord(line, user);
+
+            batch.push_back(user);
+            if (batch.size() == kSegmentSize)
+            {
+                addUsers(batch);
+                batch.clear();
+            }
+            if (Logger::shared().enabled(LogLevel::Debug))
+            {
+                Logger::shared().log(LogLevel::Debug, line);
+            }
+        }
+    }
+    catch (...)
+    {
+        addUsers(batch); // keep the users read before the error, as when they were added one by one
+        throw;
+    }
+    addUsers(batch);
+
+    file.close();
+}
+
+/**
+ * @brief Wrapper method to read user information from a file using UserInfoManager.
+ *
+ * This method acts as a simple wrapper, calling the readFromFile method in the UserInfoManager instance associated with the
+ * HealthAssistant class, passing the specified filename as an argument.
+ *
+ * @param filename The name of the file from which user information is read.
+ */
+void HealthAssistant::readFromFile(std::string filename)
+{
+    userInfoManager->readFromFile(filename);
+}
+
+/**
+ * @brief Wrapper method to import user profiles from a JSON Lines file using UserInfoManager.
+ *
+ * @param filename The name of the file from which user profiles are read.
+ */
+void HealthAssistant::importJsonLines(std::string filename)
+{
+    userInfoManager->readJsonLines(filename);
+}
+
+/**
+ * @brief Wrapper method to export user profiles to a JSON Lines file using UserInfoManager.
+ *
+ * @param filename The name of the file to which user profiles are written.
+ * @param mode WriteMode::Rewrite atomically replaces the file, WriteMode::Append adds to it.
+ */
+void HealthAssistant::exportJsonLines(std::string filename, WriteMode mode)
+{
+    userInfoManager->writeJsonLines(filename, mode);
+}
+
+/**
+ * @brief Wrapper method to display one page of users using UserInfoManager.
+ *
+ * @param cursor Cursor returned by the previous page, or empty for the first page.
+ * @param limit Maximum number of users displayed.
+ * @return std::string Cursor of the next page, empty after the last page.
+ */
+std::string HealthAssistant::displayPage(std::string cursor, std::size_t limit)
+{
+    return userInfoManager->displayPage(cursor, limit);
+}
+
+/**
+ * @brief Wrapper method to export one page of users using UserInfoManager.
+ *
+ * @param filename The file written.
+ * @param cursor Cursor returned by the previous page, or empty for the first page.
+ * @param limit Maximum number of users written.
+ * @param format Row format of the file.
+ * @param mode Whether to append to the file or atomically replace it.
+ * @return std::string Cursor of the next page, empty after the last page.
+ */
+std::string HealthAssistant::exportPage(std::string filename, std::string cursor, std::size_t limit, ExportFormat format, WriteMode mode)
+{
+    return userInfoManager->exportPage(filename, cursor, limit, format, mode);
+}
+
+/**
+ * @brief Helper function to remove trailing whitespaces.
+ *
+ * @param input String input to convert.
+ * @return std::string
+ */
+std::string trim(const std::string &str)
+{
+    auto start = str.begin();
+    auto end = str.end();
+
+    while (start != str.end() && std::isspace(*start))
+    {
+        start++;
+    }
+
+    do
+    {
+        end--;
+    } while (std::distance(start, end) > 0 && std::isspace(*end));
+
+    return std::string(start, end + 1);
+}
+
+/**
+ * @brief Helper function to convert a string to lowercase.
+ *
+ * @param input String input to convert.
+ * @return std::string
+ */
+std::string toLower(const std::string &input)
+{
+    std::string output = input;
+
+    std::transform(output.begin(), output.end(), output.begin(), [](unsigned char c)
+                   { return std::tolower(c); });
+    return output;
+}
+
+/**
+ * @brief Prompts for and sets the user's gender after validation.
+ *
+ * Continuously prompts the user to input their gender until "male" or "female" is provided.
+ * Converts the input to lowercase for validation and assigns it to the User struct field upon success.
+ * @param user Pointer to the UserInfo object for which the gender information is obtained and set.
+ */
+void UserInfoManager::getGender(UserInfo *user)
+{
+    std::string input;
+
+    while (true)
+    {
+        std::cout << "Please specify your gender as either male or female: ";
+        std::cin >> input;
+        input = toLower(trim(input));
+        bufferClear();
+
+        if (input == "male" || input == "female")
+        {
+            user->gender = input;
+            break;
+        }
+        else
+        {
+            std::cerr << "The gender entered is not yet supported. Please specify as either \"male\" or \"female\"." << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Prompts the user for their hip measurement in centimeters and assigns it to the user object.
+ *
+ * This function is only applicable if the user's gender is set to "female". It continuously prompts the user
+ * to enter their hip measurement until a valid numeric input is provided. The function checks for valid decimal
+ * or whole number input. If the input is not a valid number, it displays an error message and prompts the user again.
+ * Upon receiving a valid input, the measurement is assigned to the User struct field.
+ *
+ * @param user Pointer to the UserInfo object for which the Hip information is obtained and set.
+ */
+void UserInfoManager::getHipMeasurement(UserInfo *user)
+{
+    double input;
+
+    if (user->gender != "female")
+    {
+        return;
+    }
+    while (true)
+    {
+        std::cout << "Enter your hip measurement in centimeters: ";
+
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+            user->hip = input;
+            // std::cout << input << std::endl;
+            break;
+        }
+        else
+        {
+            std::cerr << "Invalid input for hip measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their age and validates the input.
+ *
+ * Continuously prompts the user to enter their age until a valid integer is provided.
+ * If the input is not a valid integer, it displays an error message and prompts the user again.
+ * Upon receiving a valid input, the age is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Age information is obtained and set.
+ */
+void UserInfoManager::getAge(UserInfo *user)
+{
+    double input;
+
+    while (true)
+    {
+        std::cout << "Enter your age: ";
+
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+
+            // age limits BMI
+            if (input < 20)
+            {
+                std::cerr << "You need to be older to use this tool" << std::endl;
+            }
+            else if (input > 79)
+            {
+                std::cerr << "You need to be younger to use this tool" << std::endl;
+            }
+            else{
+                user->age = input;
+                // std::cout << user.g_age << std::endl;
+                break;
+            }
+        }
+        else
+        {
+            std::cerr << "Invalid input for age. Please specify your age as a whole number." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their body weight and validates the input.
+ *
+ * Continuously prompts the user to enter their body weight in kilograms until a valid number is provided.
+ * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
+ * prompts the user again. Upon receiving a valid input, the weight is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Weight information is obtained and set.
+ */
+void UserInfoManager::getBodyWeightMeasurement(UserInfo *user)
+{
+    double input;
+
+    while (true)
+    {
+        std::cout << "Enter your body weight in kilograms: ";
+
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+            user->weight = input;
+            // std::cout << input << std::endl;
+            break;
+        }
+        else
+        {
+            std::cerr << "Invalid input for body weight. Please specify your measurement as a whole number or a decimal." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their waist measurement and validates the input.
+ *
+ * Continuously prompts the user to enter their waist measurement in centimeters until a valid number is provided.
+ * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
+ * prompts the user again. Upon receiving a valid input, the waist measurement is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Waist information is obtained and set.
+ */
+void UserInfoManager::getWaistMeasurement(UserInfo *user)
+{
+    double input;
+
+    while (true)
+    {
+        std::cout << "Input your waist measurement in centimeters: ";
+
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+            user->waist = input;
+            // std::cout << input << std::endl;
+            break;
+        }
+        else
+        {
+            std::cerr << "Invalid input for waist measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their neck measurement and validates the input.
+ *
+ * Continuously prompts the user to enter their neck measurement in centimeters until a valid number is provided.
+ * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
+ * prompts the user again. Upon receiving a valid input, the neck measurement is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Neck information is obtained and set.
+ */
+void UserInfoManager::getNeckMeasurement(UserInfo *user)
+{
+    double input;
+
+    while (true)
+    {
+        std::cout << "Provide your neck measurement in centimeters: ";
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+            user->neck = input;
+            // std::cout << input << std::endl;
+            break;
+        }
+        else
+        {
+            std::cerr << "Invalid input for neck measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their height and validates the input.
+ *
+ * This function continuously prompts the user to enter their height in centimeters until a valid numeric input is provided.
+ * The input can be either a whole number or a decimal. If the input is not a valid number, the function displays an error message
+ * and prompts the user again. Upon receiving a valid input, the height is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Height information is obtained and set.
+ */
+void UserInfoManager::getHeightMeasurement(UserInfo *user)
+{
+    double input;
+
+    while (true)
+    {
+        std::cout << "Provide your height measurement in centimeters: ";
+        if (std::cin >> input)
+        { // if the input is successfully read as a number
+            user->height = input;
+            // std::cout << input << std::endl;
+            break;
+        }
+        else
+        {
+            std::cerr << "Invalid input for height measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+        }
+        bufferClear();
+    }
+    bufferClear();
+}
+
+/**
+ * @brief Prompts the user for their lifestyle choice and validates the input.
+ *
+ * Continuously prompts the user to specify their lifestyle as either "sedentary", "moderate", or "active".
+ * The input is case-insensitive. If the input does not match any of the expected lifestyle choices, it displays an error message and
+ * prompts the user again. Upon receiving a valid input, the lifestyle choice is assigned to the User struct field.
+ * @param user Pointer to the UserInfo object for which the Lifestyle information is obtained and set.
+ */
+void UserInfoManager::getLifestyle(UserInfo *user)
+{
+    std::string input;
+
+    while (true)
+    {
+        std::cout << "Provide information about your current lifestyle: sedentary, moderate (moderately active) or active: ";
+        std::cin >> input;
+        input = toLower(trim(input));
+        bufferClear();
+
+        if (input == "moderately")
+        {
+            input = "moderate";
+        }
+
+        if (input == "sedentary" || input == "moderate" || input == "active")
+        {
+            user->lifestyle = input;
+            break;
+        }
+        else
+        {
+            std::cerr << "The lifestyle you entered is not yet supported. Please specify as either \"sedentary\", \"moderate\", or \"active\"." << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Gets and sets the name information for a user.
+ *
+ * This method prompts the user to enter their name and sets the name attribute in the UserInfo object accordingly.
+ *
+ * @param user Pointer to the UserInfo object for which the name information is obtained and set.
+ */
+void UserInfoManager::getName(UserInfo *user)
+{
+    std::string input;
+    std::cout << "What is your name: ";
+    std::cin >> input;
+    bufferClear();
+
+    user->name = toLower(trim(input));
+}
+
+/**
+ * @brief Mass loads user information from a file and computes additional attributes.
+ *
+ * This method reads user information from a CSV file, creates UserInfo objects, and adds them to the linked list.
+ * It then calculates the Body Fat Percentage (BFP), daily calorie intake, and recommended macronutrient distribution for each user,
+ * except for extended records whose stored results were computed by this method under the current kFormulaVersion.
+ *
+ * @param filename The name of the file from which user information is mass-loaded.
+ * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ */
+void HealthAssistant::massLoadAndCompute(std::string filename)
+{
+    std::ifstream file(filename);
+    std::string line;
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
+        return;
+    }
+
+    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
+    if (ifs.tellg() == 0)
+    {
+        throw std::runtime_error("File is empty: " + filename);
+    }
+
+    std::vector<UserInfo*> batch;
+    try
+    {
+        while (getline(file, line))
+        {
+            UserInfo *user = new UserInfo;
+            bool stored = parseUserRecord(line, user) == getBfpType();
+
+            if (!stored && (!computeCache || !computeCache->lookup(user, getBfpType())))
+            {
+                getBfp(user);
+                getDailyCalories(user);
+                getMealPrep(user);
+                if (computeCache)
+                {
+                    computeCache->store(user, getBfpType());
+                }
+            }
+
+            batch.push_back(user);
+            if (batch.size() == UserInfoManager::kSegmentSize)
+            {
+                userInfoManager->addUsers(batch);
+                batch.clear();
+            }
+        }
+    }
+    catch (...)
+    {
+        userInfoManager->addUsers(batch); // keep the users read before the error, as when they were added one by one
+        throw;
+    }
+    userInfoManager->addUsers(batch);
+
+    file.close();
+}
+
+/**
+ * @brief Adds user information to the manager.
+ *
+ * This function adds the provided user information to the list of user information managed by the UserInfoManager.
+ *
+ * @param userInfo A pointer to the UserInfo object containing the user's information to be added.
+ */
+void UserInfoManager::addUserInfo(UserInfo *userInfo){
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    dirtyFrom = std::min(dirtyFrom, userInfoList.size());
+    userInfoList.push_back(userInfo);
+    userIds.push_back(nextUserId++);
+    publishedUsers.push_back(std::make_shared<const UserInfo>(*userInfo));
+    liveStats.account(userInfo, 1);
+    publish();
+}
+
+/**
+ * @brief Adds a batch of users, publishing a single new snapshot for all of them.
+ *
+ * Loaders add users in batches of kSegmentSize, so a load rebuilds the last segment of the
+ * published snapshot once per batch instead of once per user.
+ *
+ * @param users Pointers to the UserInfo objects to add; the manager takes ownership.
+ */
+void UserInfoManager::addUsers(const std::vector<UserInfo*> &users)
+{
+    if (users.empty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    dirtyFrom = std::min(dirtyFrom, userInfoList.size());
+    for (UserInfo *userInfo : users)
+    {
+        userInfoList.push_back(userInfo);
+        userIds.push_back(nextUserId++);
+        publishedUsers.push_back(std::make_shared<const UserInfo>(*userInfo));
+        liveStats.account(userInfo, 1);
+    }
+    publish();
+}
+
+/**
+ * @brief Clears the input buffer.
+ *
+ * This function clears the input buffer of the standard input stream (std::cin).
+ * It is useful for discarding any remaining characters in the input buffer, such as after
+ * an invalid input or when switching between different types of input.
+ */
+void bufferClear()
+{
+    std::cin.clear();
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+}
+
+/**
+ * @brief Loads user information from a file and computes body fat percentage (BFP) for each user.
+ *
+ * This function reads user information from the specified file and computes the body fat percentage
+ * (BFP) for each user using the specified method (BMI method or US Navy method). It returns a shared
+ * pointer to a vector containing pointers to UserInfo objects, representing the loaded user information.
+ * Extended records holding results of the same method and kFormulaVersion are used as stored.
+ *
+ * @param filename The name of the file containing user information.
+ * @param bfpType The type of method used to compute body fat percentage (BMI method or US Navy method).
+ * @return A shared pointer to a vector containing pointers to UserInfo objects representing the loaded user information.
+ * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ */
+std::shared_ptr<std::vector<UserInfo*>> UserStats::massLoadAndCompute(std::string filename, BfpType bfpType)
+{
+    std::ifstream file(filename);
+    std::string line;
+    std::shared_ptr<std::vector<UserInfo*>> UserInfoList = std::make_shared<std::vector<UserInfo*>>();
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
+    }
+
+    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
+    if (ifs.tellg() == 0)
+    {
+        throw std::runtime_error("File is empty: " + filename);
+    }
+
+    std::vector<UserInfo*> pending; // users whose BFP is left to the column kernel
+    MeasurementColumns<float> columns;
+
+    while (getline(file, line))
+    {
+        UserInfo *user = new UserInfo;
+
+        if (parseUserRecord(line, user) == bfpType)
+        {
+            // Results stored by the current formulas
+            UserInfoList->push_back(user);
+            continue;
+        }
+
+        if (computeCache && computeCache->lookup(user, bfpType))
+        {
+            UserInfoList->push_back(user);
+            continue;
+        }
+
+        if (computePrecision == ComputePrecision::Float)
+        {
+            // BFP is computed for the whole file at once by the column kernel below
+            getDailyCalories(user);
+            getMealPrep(user);
+            UserInfoList->push_back(user);
+            pending.push_back(user);
+            columns.push_back(user);
+            continue;
+        }
+
+        if (bfpType == BfpType::BmiMethod)
+        {
+            bmiMethod(user);
+        }
+        else if (bfpType == BfpType::USNavyMethod)
+        {
+            usNavyMethod(user);
+        }
+
+        getDailyCalories(user);
+        getMealPrep(user);
+
+        if (computeCache)
+        {
+            computeCache->store(user, bfpType);
+        }
+
+        UserInfoList->push_back(user);
+    }
+
+    file.close();
+
+    if (!pending.empty())
+    {
+        std::vector<int> bfp;
+        std::vector<BfpCategory> category;
+        computeBfpColumns(columns, bfpType, bfp, category);
+
+        for (std::size_t i = 0; i < pending.size(); i++)
+        {
+            UserInfo *user = pending[i];
+            if (bfpType == BfpType::USNavyMethod && category[i] == BfpCategory::Unknown && columns.gender[i] != Gender::Unknown)
+            {
+                Logger::shared().log(LogLevel::Warn, "The body fat category cannot be determined because you are outside of the permitted age range.");
+            }
+            user->bfp = std::make_pair(bfp[i], categoryLabel(bfpType, category[i]));
+            user->bfpType = bfpType == BfpType::BmiMethod || columns.gender[i] != Gender::Unknown ? std::optional<BfpType>(bfpType) : std::nullopt;
+            if (computeCache)
+            {
+                computeCache->store(user, bfpType);
+            }
+        }
+    }
+
+    return UserInfoList;
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for a user using the US Navy method and assigns the result to the user object.
+ *
+ * This function calculates the body fat percentage for the specified user using the US Navy method.
+ * The calculation is based on the user's gender, age, waist, hip, neck, and height.
+ * If the user's age falls outside the permitted range, the function prints a message indicating that
+ * the body fat category cannot be determined.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void UserStats::usNavyMethod(UserInfo *user)
+{
+    double bfp = 0.0;
+    std::string category;
+
+    if (user->gender == "female")
+    {
         bfp = (495.0 / (1.29579 - 0.35004 * log10(user->waist + user->hip - user->neck) + 0.22100 * log10(user->height))) - 450.0;
 
-        if (user->age >= 20 && user->age <= 39)
+        if (user->age >= 20 && user->age <= 39)
+        {
+            if (bfp < 21)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 33)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 39)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 40 && user->age <= 59)
+        {
+            if (bfp < 23)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 34)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 40)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 60 && user->age <= 79)
+        {
+            if (bfp < 24)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 36)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 42)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else
+        {
+            Logger::shared().log(LogLevel::Warn, "The body fat category cannot be determined because you are outside of the permitted age range.");
+        }
+    }
+    else if (user->gender == "male")
+    {
+        bfp = (495.0 / (1.0324 - 0.19077 * log10(user->waist - user->neck) + 0.15456 * log10(user->height))) - 450.0;
+        if (user->age >= 20 && user->age <= 39)
+        {
+            if (bfp < 8)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 20)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 25)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 40 && user->age <= 59)
+        {
+            if (bfp < 11)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 22)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 28)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else if (user->age >= 60 && user->age <= 79)
+        {
+            if (bfp < 13)
+            {
+                category = "USNavy: Low";
+            }
+            else if (bfp < 25)
+            {
+                category = "USNavy: Normal";
+            }
+            else if (bfp < 30)
+            {
+                category = "USNavy: High";
+            }
+            else
+            {
+                category = "USNavy: Very High";
+            }
+        }
+        else
+        {
+            Logger::shared().log(LogLevel::Warn, "The body fat category cannot be determined because you are outside of the permitted age range.");
+        }
+    }
+
+    // Return Body Fat Percentage (BFP) and category as a pair; genders without a formula stay uncomputed
+    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    user->bfpType = user->gender == "female" || user->gender == "male" ? std::optional<BfpType>(BfpType::USNavyMethod) : std::nullopt;
+}
+
+/**
+ * @brief Calculates the body fat percentage (BFP) for a user using the BMI method and assigns the result to the user object.
+ *
+ * This function calculates the body fat percentage for the specified user using the BMI method.
+ * The calculation is based on the user's weight and height.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void UserStats::bmiMethod(UserInfo *user)
+{
+    double bfp = 0.0;
+    std::string category;
+
+    bfp = (user->weight*100*100)/(user->height*user->height);
+
+    if (bfp < 18.5)
+    {
+        category = "Bmi: Low";
+    }
+    else if (bfp < 25)
+    {
+        category = "Bmi: Normal";
+    }
+    else if (bfp < 30)
+    {
+        category = "Bmi: High";
+    }
+    else
+    {
+        category = "Bmi: Very High";
+    }
+
+    // Return Body Fat Percentage (BFP) and category as a pair
+    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    user->bfpType = BfpType::BmiMethod;
+}
+
+/**
+ * @brief Calculates the daily caloric intake for a user based on gender, age, and lifestyle.
+ *
+ * This function calculates the daily caloric intake for the specified user based on their gender,
+ * age, and lifestyle (sedentary, moderate, or active). The calculation follows standard guidelines
+ * for daily caloric needs according to gender, age group, and activity level.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void UserStats::getDailyCalories(UserInfo *user)
+{
+    int calories = 0;
+
+    if (user->gender == "male")
+    {
+        if (user->age >= 19 && user->age <= 30)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2400;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2800;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 3000;
+            }
+        }
+        else if (user->age >= 31 && user->age <= 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2200;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2600;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 3000;
+            }
+        }
+        else if (user->age > 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2400;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2800;
+            }
+        }
+    }
+    else if (user->gender == "female")
+    {
+        if (user->age >= 19 && user->age <= 30)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2200;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2400;
+            }
+        }
+        else if (user->age >= 31 && user->age <= 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 1800;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 2000;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2200;
+            }
+        }
+        else if (user->age > 50)
+        {
+            if (user->lifestyle == "sedentary")
+            {
+                calories = 1600;
+            }
+            else if (user->lifestyle == "moderate")
+            {
+                calories = 1800;
+            }
+            else if (user->lifestyle == "active")
+            {
+                calories = 2200;
+            }
+        }
+    } else {
+        Logger::shared().log(LogLevel::Warn, "This is ackward, your intake calarie wasn't able to be processed");
+        calories = 0;
+    }
+
+    user->daily_calories = calories;
+}
+
+/**
+ * @brief Calculates the macronutrient distribution for meal preparation based on daily caloric intake.
+ *
+ * This function calculates the distribution of macronutrients (carbohydrates, protein, and fat)
+ * for meal preparation based on the user's daily caloric intake. It defines the percentage of total
+ * calories for each macronutrient and then calculates the calories and grams for carbohydrates, protein,
+ * and fat accordingly.
+ *
+ * @param user A pointer to the UserInfo object containing the user's information.
+ */
+void UserStats::getMealPrep(UserInfo *user)
+{
+    // Define the percentage of total calories for each macronutrient
+    const double carbs_percentage = 0.50;
+    const double protein_percentage = 0.30;
+    const double fat_percentage = 0.20;
+
+    // Calculate the calories for each macronutrient
+    double carbs_calories = user->daily_calories * carbs_percentage;
+    double protein_calories = user->daily_calories * protein_percentage;
+    double fat_calories = user->daily_calories * fat_percentage;
+
+    // Calculate the grams for each macronutrient
+    user->carbs = carbs_calories / 4.0;
+    user->protein = protein_calories / 4.0;
+    user->fat = fat_calories / 9.0;
+}
+
+/**
+ * @brief Retrieves the names of healthy users based on the specified method and gender.
+ *
+ * This function retrieves the names of healthy users based on the specified method (BMI or US Navy)
+ * and gender. It loads user information from the appropriate data file and computes the necessary
+ * health-related metrics. Then, it filters users based on their gender and body fat percentage category
+ * (e.g., "Bmi: Normal" for the BMI method or "USNavy: Normal" for the US Navy method) and returns
+ * a vector containing the names of healthy users.
+ *
+ * @param method The method used to compute body fat percentage (BMI or US Navy).
+ * @param gender The gender of users to retrieve (male or female).
+ * @return A vector containing the names of healthy users based on the specified method and gender.
+ */
+std::vector<std::string> UserStats::GetHealthyUsers(std::string method, std::string gender)
+{
+    RowSet healthyUsers;
+    if (method == "bmi" || method == "USArmy")
+    {
+        healthyUsers = SelectUsers(method, { Condition::is(genderFromString(gender)), Condition::is(BfpCategory::Normal) });
+    }
+
+    std::cout << "Healthy Users (" << gender << ", " << method << " method):" << std::endl;
+    healthyUsers.print(std::cout);
+
+    return healthyUsers.toStrings();
+}
+
+/**
+ * @brief Retrieves the names of healthy users based on the specified method.
+ *
+ * This function retrieves the names of healthy users based on the specified method (BMI or US Navy).
+ * It loads user information from the appropriate data files, computes the necessary health-related metrics,
+ * and filters users based on their body fat percentage category (e.g., "Bmi: Normal" for the BMI method
+ * or "USNavy: Normal" for the US Navy method). The function returns a vector containing the names of
+ * healthy users regardless of gender.
+ *
+ * @param method The method used to compute body fat percentage (BMI or US Navy).
+ * @return A vector containing the names of healthy users based on the specified method.
+ */
+std::vector<std::string> UserStats::GetHealthyUsers(std::string method)
+{
+    RowSet healthyUsers = SelectUsers("all", { Condition::is(BfpCategory::Normal) });
+
+    std::cout << "All Healthy Users " << std::endl;
+    healthyUsers.print(std::cout);
+
+    return healthyUsers.toStrings();
+}
+
+/**
+ * @brief Retrieves the names of unfit users based on the specified method and gender.
+ *
+ * This function retrieves the names of unfit users based on the specified method (BMI or US Navy)
+ * and gender. It loads user information from the appropriate data file, computes the necessary
+ * health-related metrics, and filters users based on their gender and body fat percentage category.
+ * Unfit users are those whose body fat percentage category does not match the "Normal" category
+ * for the specified method.
+ *
+ * @param method The method used to compute body fat percentage (BMI or US Navy).
+ * @param gender The gender of users to retrieve (male or female).
+ * @return A vector containing the names of unfit users based on the specified method and gender.
+ */
+std::vector<std::string> UserStats::GetUnfitUsers(std::string method, std::string gender)
+{
+    RowSet unfitUsers;
+    if (method == "bmi" || method == "USArmy")
+    {
+        unfitUsers = SelectUsers(method, { Condition::is(genderFromString(gender)), Condition::isNot(BfpCategory::Normal) });
+    }
+
+    std::cout << "Unfit Users (" << gender << ", " << method << " method):" << std::endl;
+    unfitUsers.print(std::cout);
+
+    return unfitUsers.toStrings();
+}
+
+/**
+ * @brief Retrieves the names of unfit users based on the specified method.
+ *
+ * This function retrieves the names of unfit users based on the specified method (BMI or US Navy).
+ * It loads user information from the appropriate data files, computes the necessary health-related metrics,
+ * and filters users based on their body fat percentage category. Unfit users are those whose body fat percentage
+ * category does not match the "Normal" category for the specified method.
+ *
+ * @param method The method used to compute body fat percentage (BMI or US Navy).
+ * @return A vector containing the names of unfit users based on the specified method.
+ */
+std::vector<std::string> UserStats::GetUnfitUsers(std::string method)
+{
+    RowSet unfitUsers = SelectUsers("all", { Condition::isNot(BfpCategory::Normal) });
+
+    std::cout << "All Unfit Users " << std::endl;
+    unfitUsers.print(std::cout);
+
+    return unfitUsers.toStrings();
+}
+
+/**
+ * @brief Retrieves the full statistics regarding user health.
+ *
+ * This function computes and displays various statistics regarding user health,
+ * including the total number of users, the percentage of male and female users,
+ * and the percentage of users categorized as healthy based on BMI and US Navy methods.
+ *
+ * It loads user information from BMI and US Navy data files, computes the necessary health-related metrics,
+ * and calculates statistics such as the total number of users, the percentage of male and female users,
+ * and the percentage of users with healthy body fat percentage categories for both methods.
+ *
+ * The function prints these statistics to the console.
+ */
+void UserStats::GetFullStats()
+{
+    std::shared_ptr<const UserTable> bmiUserStats;
+    std::shared_ptr<const UserTable> usUserStats;
+    bmiUserStats = loadTable("bmi_user_data.csv", BfpType::BmiMethod);
+    usUserStats = loadTable("us_user_data.csv", BfpType::USNavyMethod);
+
+    // Every statistic of a dataset is computed in the same single scan
+    AggregateQuery query;
+    std::size_t female = query.count({ Condition::is(Gender::Female) });
+    std::size_t male = query.count({ Condition::is(Gender::Male) });
+    std::size_t healthy = query.count({ Condition::is(BfpCategory::Normal) });
+    std::size_t healthyFemale = query.count({ Condition::is(BfpCategory::Normal), Condition::is(Gender::Female) });
+    std::size_t healthyMale = query.count({ Condition::is(BfpCategory::Normal), Condition::is(Gender::Male) });
+    std::size_t bfpMean = query.add(AggregateOp::Mean, Column::Bfp);
+    std::size_t bfpVariance = query.add(AggregateOp::Variance, Column::Bfp);
+    std::size_t weightMean = query.add(AggregateOp::Mean, Column::Weight);
+    std::size_t weightVariance = query.add(AggregateOp::Variance, Column::Weight);
+    std::size_t caloriesMean = query.add(AggregateOp::Mean, Column::DailyCalories);
+    std::size_t caloriesVariance = query.add(AggregateOp::Variance, Column::DailyCalories);
+
+    std::vector<double> bmi = query.run({ bmiUserStats }, threadCount);
+    std::vector<double> us = query.run({ usUserStats }, threadCount);
+
+    int maleCount = bmi[male] + us[male], femaleCount = bmi[female] + us[female];
+    int healthyBmiCount = bmi[healthy], healthyUsArmyCount = us[healthy];
+    int healthyMaleBmiCount = bmi[healthyMale], healthyFemaleBmiCount = bmi[healthyFemale];
+    int healthyMaleUsArmyCount = us[healthyMale], healthyFemaleUsArmyCount = us[healthyFemale];
+
+    // Total Users
+    int totalUsers = bmiUserStats->size() + usUserStats->size();
+
+    std::cout << "total users: " << totalUsers << std::endl;
+    std::cout << "male/female percentage: " << maleCount*100/totalUsers << "% / " << femaleCount*100/totalUsers << "%" << std::endl;
+    std::cout << "healty bmi: " << healthyBmiCount*100/bmiUserStats->size() << "%"<< std::endl;
+    std::cout << "healty bmi male/female: " << healthyMaleBmiCount*100/bmiUserStats->size() << "% / "  << healthyFemaleBmiCount*100/bmiUserStats->size() << "%" << std::endl;
+    std::cout << "healty us: " << healthyUsArmyCount*100/usUserStats->size() << "%"<< std::endl;
+    std::cout << "healty us male/female: " << healthyMaleUsArmyCount*100/usUserStats->size() << "% / " << healthyFemaleUsArmyCount*100/usUserStats->size() << "%"<< std::endl;
+
+    std::cout << "bmi mean (variance) bfp/weight/calories: "
+              << double_to_string(bmi[bfpMean], 2) << " (" << double_to_string(bmi[bfpVariance], 2) << ") / "
+              << double_to_string(bmi[weightMean], 2) << " (" << double_to_string(bmi[weightVariance], 2) << ") / "
+              << double_to_string(bmi[caloriesMean], 2) << " (" << double_to_string(bmi[caloriesVariance], 2) << ")" << std::endl;
+    std::cout << "us mean (variance) bfp/weight/calories: "
+              << double_to_string(us[bfpMean], 2) << " (" << double_to_string(us[bfpVariance], 2) << ") / "
+              << double_to_string(us[weightMean], 2) << " (" << double_to_string(us[weightVariance], 2) << ") / "
+              << double_to_string(us[caloriesMean], 2) << " (" << double_to_string(us[caloriesVariance], 2) << ")" << std::endl;
+}
+
+/**
+ * @brief Maps a gender string to its Gender code.
+ *
+ * @param gender The gender as stored in UserInfo ("male" or "female").
+ * @return Gender The matching code, or Gender::Unknown for anything else.
+ */
+Gender genderFromString(const std::string &gender)
+{
+    if (gender == "male")
+    {
+        return Gender::Male;
+    }
+    else if (gender == "female")
+    {
+        return Gender::Female;
+    }
+    return Gender::Unknown;
+}
+
+/**
+ * @brief Maps a lifestyle string to its Lifestyle code.
+ *
+ * @param lifestyle The lifestyle as stored in UserInfo ("sedentary", "moderate" or "active").
+ * @return Lifestyle The matching code, or Lifestyle::Unknown for anything else.
+ */
+Lifestyle lifestyleFromString(const std::string &lifestyle)
+{
+    if (lifestyle == "sedentary")
+    {
+        return Lifestyle::Sedentary;
+    }
+    else if (lifestyle == "moderate")
+    {
+        return Lifestyle::Moderate;
+    }
+    else if (lifestyle == "active")
+    {
+        return Lifestyle::Active;
+    }
+    return Lifestyle::Unknown;
+}
+
+/**
+ * @brief Constructs an empty compute cache.
+ *
+ * @param capacity Maximum number of distinct tuples kept. Once reached, new tuples are still computed
+ *                 but no longer stored, so memory stays bounded on data without duplication.
+ */
+ComputeCache::ComputeCache(std::size_t capacity) : capacity(capacity)
+{
+}
+
+/**
+ * @brief Reduces an age to the brackets distinguished by the BFP and calorie formulas.
+ *
+ * The US Navy categories split at 20-39, 40-59 and 60-79 while the calorie table splits at
+ * 19-30, 31-50 and over 50. Every age inside one of the returned brackets gives identical results.
+ *
+ * @param age Age of the user in years.
+ * @return std::uint8_t The bracket index.
+ */
+std::uint8_t ComputeCache::ageBracket(int age)
+{
+    if (age < 19) return 0;
+    if (age < 20) return 1;
+    if (age <= 30) return 2;
+    if (age <= 39) return 3;
+    if (age <= 50) return 4;
+    if (age <= 59) return 5;
+    if (age <= 79) return 6;
+    return 7;
+}
+
+/**
+ * @brief Builds the cache key for a user, if the user may be cached.
+ *
+ * The measurements are kept exactly; adding 0.0 only turns -0.0 into 0.0 so that equal keys hash
+ * alike.
+ *
+ * @param user A pointer to the UserInfo object containing the user's measurements.
+ * @param bfpType The method used to compute body fat percentage.
+ * @param key Receives the tuple.
+ * @return true if the user may be cached, false if computing it logs a warning or a measurement is not finite.
+ */
+bool ComputeCache::makeKey(const UserInfo *user, BfpType bfpType, Key &key)
+{
+    Gender gender = genderFromString(user->gender);
+    if (gender == Gender::Unknown || (bfpType == BfpType::USNavyMethod && (user->age < 20 || user->age > 79)))
+    {
+        return false;
+    }
+    if (!std::isfinite(user->waist) || !std::isfinite(user->neck) || !std::isfinite(user->hip)
+        || !std::isfinite(user->height) || !std::isfinite(user->weight))
+    {
+        return false;
+    }
+
+    key.waist = user->waist + 0.0;
+    key.neck = user->neck + 0.0;
+    key.hip = user->hip + 0.0;
+    key.height = user->height + 0.0;
+    key.weight = user->weight + 0.0;
+    key.bfpType = static_cast<std::uint8_t>(bfpType);
+    key.gender = static_cast<std::uint8_t>(gender);
+    key.ageBracket = ageBracket(user->age);
+    key.lifestyle = static_cast<std::uint8_t>(lifestyleFromString(user->lifestyle));
+    return true;
+}
+
+bool ComputeCache::Key::operator==(const Key &other) const
+{
+    return waist == other.waist && neck == other.neck && hip == other.hip && height == other.height
+        && weight == other.weight && bfpType == other.bfpType && gender == other.gender
+        && ageBracket == other.ageBracket && lifestyle == other.lifestyle;
+}
+
+std::size_t ComputeCache::KeyHash::operator()(const Key &key) const
+{
+    // splitmix64 finalizer over the packed fields
+    auto mix = [](std::uint64_t x) {
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    };
+    std::uint64_t codes = (static_cast<std::uint64_t>(key.bfpType) << 24) | (static_cast<std::uint64_t>(key.gender) << 16)
+        | (static_cast<std::uint64_t>(key.ageBracket) << 8) | key.lifestyle;
+    std::uint64_t h = mix(codes);
+    for (double value : { key.waist, key.neck, key.hip, key.height, key.weight })
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        h = mix(h ^ bits);
+    }
+    return static_cast<std::size_t>(h);
+}
+
+/**
+ * @brief Looks up the computed metrics for a user's measurement tuple.
+ *
+ * On a hit the BFP, category, daily calories and macros are copied into the user and the
+ * computation can be skipped entirely.
+ *
+ * @param user A pointer to the UserInfo object to fill in.
+ * @param bfpType The method used to compute body fat percentage.
+ * @return true if the tuple was cached, false otherwise.
+ */
+bool ComputeCache::lookup(UserInfo *user, BfpType bfpType)
+{
+    Key key;
+    if (!makeKey(user, bfpType, key))
+    {
+        misses++;
+        return false;
+    }
+
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    user->bfp = it->second.bfp;
+    user->bfpType = bfpType;
+    user->daily_calories = it->second.daily_calories;
+    user->carbs = it->second.carbs;
+    user->protein = it->second.protein;
+    user->fat = it->second.fat;
+    return true;
+}
+
+/**
+ * @brief Stores the computed metrics of a user under its measurement tuple.
+ *
+ * @param user A pointer to the UserInfo object whose metrics have been computed.
+ * @param bfpType The method used to compute body fat percentage.
+ */
+void ComputeCache::store(const UserInfo *user, BfpType bfpType)
+{
+    Key key;
+    if (entries.size() >= capacity || !makeKey(user, bfpType, key))
+    {
+        return;
+    }
+    entries.emplace(key, Value{user->bfp, user->daily_calories, user->carbs, user->protein, user->fat});
+}
+
+/**
+ * @brief Drops every cached tuple and resets the hit/miss counters.
+ */
+void ComputeCache::clear()
+{
+    entries.clear();
+    hits = 0;
+    misses = 0;
+}
+
+/**
+ * @brief Returns the hit/miss counters of the cache.
+ *
+ * @return ComputeCacheStats The current counters and number of cached tuples.
+ */
+ComputeCacheStats ComputeCache::getStats() const
+{
+    ComputeCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.entries = entries.size();
+    return stats;
+}
+
+/**
+ * @brief Prints the hit-rate metrics of the cache to the console.
+ *
+ * @param label Name printed in front of the metrics.
+ */
+void ComputeCache::report(const std::string &label) const
+{
+    ComputeCacheStats stats = getStats();
+    std::cout << label << " compute cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.entries << " entries, hit rate " << double_to_string(stats.hitRate() * 100, 1) << "%" << std::endl;
+}
+
+/**
+ * @brief Turns the compute cache used by massLoadAndCompute on or off.
+ *
+ * Disabling the cache releases all cached tuples.
+ *
+ * @param enabled Whether repeated measurement tuples should be served from the cache.
+ */
+void HealthAssistant::enableComputeCache(bool enabled)
+{
+    if (enabled && !computeCache)
+    {
+        computeCache = std::make_unique<ComputeCache>();
+    }
+    else if (!enabled)
+    {
+        computeCache.reset();
+    }
+}
+
+/**
+ * @brief Returns the hit-rate metrics of the compute cache.
+ *
+ * @return ComputeCacheStats The cache counters, all zero when the cache is disabled.
+ */
+ComputeCacheStats HealthAssistant::getComputeCacheStats() const
+{
+    return computeCache ? computeCache->getStats() : ComputeCacheStats();
+}
+
+/**
+ * @brief Turns the compute cache used when loading the data files on or off.
+ *
+ * The cache is shared by both methods since the method is part of the key.
+ *
+ * @param enabled Whether repeated measurement tuples should be served from the cache.
+ */
+void UserStats::enableComputeCache(bool enabled)
+{
+    if (enabled && !computeCache)
+    {
+        computeCache = std::make_unique<ComputeCache>();
+    }
+    else if (!enabled)
+    {
+        computeCache.reset();
+    }
+}
+
+/**
+ * @brief Returns the hit-rate metrics of the compute cache.
+ *
+ * @return ComputeCacheStats The cache counters, all zero when the cache is disabled.
+ */
+ComputeCacheStats UserStats::getComputeCacheStats() const
+{
+    return computeCache ? computeCache->getStats() : ComputeCacheStats();
+}
+
+/**
+ * @brief Builds the category label stored in UserInfo::bfp for a category code.
+ *
+ * @param bfpType The method the category was computed with.
+ * @param category The category code.
+ * @return std::string The label, e.g. "Bmi: Normal" or "USNavy: Very High", or an empty string for Unknown.
+ */
+std::string categoryLabel(BfpType bfpType, BfpCategory category)
+{
+    std::string prefix = bfpType == BfpType::BmiMethod ? "Bmi: " : "USNavy: ";
+
+    switch (category)
+    {
+        case BfpCategory::Low:
+            return prefix + "Low";
+        case BfpCategory::Normal:
+            return prefix + "Normal";
+        case BfpCategory::High:
+            return prefix + "High";
+        case BfpCategory::VeryHigh:
+            return prefix + "Very High";
+        default:
+            return "";
+    }
+}
+
+/**
+ * @brief Reserves room for the given number of users in every column.
+ *
+ * @param count Number of users that will be appended.
+ */
+template <typename Real>
+void MeasurementColumns<Real>::reserve(std::size_t count)
+{
+    weight.reserve(count);
+    waist.reserve(count);
+    neck.reserve(count);
+    hip.reserve(count);
+    height.reserve(count);
+    age.reserve(count);
+    gender.reserve(count);
+}
+
+/**
+ * @brief Appends the measurements of a user, converted to the column precision.
+ *
+ * @param user A pointer to the UserInfo object containing the user's measurements.
+ */
+template <typename Real>
+void MeasurementColumns<Real>::push_back(const UserInfo *user)
+{
+    weight.push_back(static_cast<Real>(user->weight));
+    waist.push_back(static_cast<Real>(user->waist));
+    neck.push_back(static_cast<Real>(user->neck));
+    hip.push_back(static_cast<Real>(user->hip));
+    height.push_back(static_cast<Real>(user->height));
+    age.push_back(user->age);
+    gender.push_back(genderFromString(user->gender));
+}
+
+/**
+ * @brief Computes the BFP and its category for every user of the columns.
+ *
+ * This is the column counterpart of UserStats::bmiMethod and UserStats::usNavyMethod: the same formulas
+ * and thresholds, evaluated in the precision of the columns. The formula pass is kept free of branches
+ * on strings so it vectorizes; categories are then looked up from the per-gender, per-age-bracket thresholds.
+ * Users outside of the US Navy age brackets get BfpCategory::Unknown.
+ *
+ * @param columns The measurements of the users.
+ * @param bfpType The method used to compute body fat percentage.
+ * @param bfp Receives the truncated body fat percentage of every user.
+ * @param category Receives the category of every user.
+ */
+template <typename Real>
+void computeBfpColumns(const MeasurementColumns<Real> &columns, BfpType bfpType,
+                       std::vector<int> &bfp, std::vector<BfpCategory> &category)
+{
+    // Thresholds separating Low/Normal/High/Very High, indexed by [female][age bracket]
+    static const Real usNavyThresholds[2][3][3] = {
+        { { 8, 20, 25 }, { 11, 22, 28 }, { 13, 25, 30 } },
+        { { 21, 33, 39 }, { 23, 34, 40 }, { 24, 36, 42 } },
+    };
+    static const Real bmiThresholds[3] = { static_cast<Real>(18.5), 25, 30 };
+
+    const std::size_t count = columns.size();
+    std::vector<Real> value(count);
+    bfp.resize(count);
+    category.resize(count);
+
+    if (bfpType == BfpType::BmiMethod)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            value[i] = (columns.weight[i] * 100 * 100) / (columns.height[i] * columns.height[i]);
+        }
+    }
+    else
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Real female = (static_cast<Real>(495.0) / (static_cast<Real>(1.29579) - static_cast<Real>(0.35004) * std::log10(columns.waist[i] + columns.hip[i] - columns.neck[i])
+                          + static_cast<Real>(0.22100) * std::log10(columns.height[i]))) - static_cast<Real>(450.0);
+            Real male = (static_cast<Real>(495.0) / (static_cast<Real>(1.0324) - static_cast<Real>(0.19077) * std::log10(columns.waist[i] - columns.neck[i])
+                        + static_cast<Real>(0.15456) * std::log10(columns.height[i]))) - static_cast<Real>(450.0);
+            value[i] = columns.gender[i] == Gender::Female ? female : (columns.gender[i] == Gender::Male ? male : 0);
+        }
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const Real *thresholds = bmiThresholds;
+        bfp[i] = static_cast<int>(value[i]);
+
+        if (bfpType == BfpType::USNavyMethod)
+        {
+            int age = columns.age[i];
+            if (columns.gender[i] == Gender::Unknown || age < 20 || age > 79)
+            {
+                category[i] = BfpCategory::Unknown;
+                continue;
+            }
+            thresholds = usNavyThresholds[columns.gender[i] == Gender::Female ? 1 : 0][(age - 20) / 20];
+        }
+
+        if (value[i] < thresholds[0])
+        {
+            category[i] = BfpCategory::Low;
+        }
+        else if (value[i] < thresholds[1])
+        {
+            category[i] = BfpCategory::Normal;
+        }
+        else if (value[i] < thresholds[2])
+        {
+            category[i] = BfpCategory::High;
+        }
+        else
+        {
+            category[i] = BfpCategory::VeryHigh;
+        }
+    }
+}
+
+/**
+ * @brief Selects the precision used to compute BFP when loading the data files.
+ *
+ * ComputePrecision::Float loads the measurements into float columns and runs the column kernel over
+ * the users missing from the compute cache. See ComputePrecision for the measured category-flip rate
+ * against the double path. Changing the precision empties the dataset and compute caches, so results
+ * of one precision are never reused by the other.
+ *
+ * @param precision The precision to use.
+ */
+void UserStats::setComputePrecision(ComputePrecision precision)
+{
+    if (precision != computePrecision)
+    {
+        clearDatasetCache();
+        if (computeCache)
+        {
+            computeCache->clear();
+        }
+    }
+    computePrecision = precision;
+}
+
+/**
+ * @brief Adds a value to the running moments.
+ *
+ * @param value The value to accumulate.
+ */
+void RunningMoments::add(double value)
+{
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+/**
+ * @brief Combines the moments of another, disjoint set of values into this one (Chan et al.).
+ *
+ * @param other The moments to merge in.
+ */
+void RunningMoments::merge(const RunningMoments &other)
+{
+    if (other.count == 0)
+    {
+        return;
+    }
+    if (count == 0)
+    {
+        *this = other;
+        return;
+    }
+
+    std::size_t total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+    count = total;
+}
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param workerCount Number of workers; the threads calling run() work alongside them.
+ */
+ThreadPool::ThreadPool(unsigned workerCount)
+{
+    for (unsigned i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back([this]() {
+            while (true)
+            {
+                std::function<void()> work;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+                    work = std::move(queue.front());
+                    queue.pop_front();
+                }
+                work();
+            }
+        });
+    }
+}
+
+/**
+ * @brief Stops the workers once the queued work has drained.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Runs a task once for every index in [0, taskCount) and waits for all of them.
+ *
+ * The state of a run is shared with the workers it enlists, so a worker that only gets to it after
+ * every index is taken simply finds nothing left to do. The first exception thrown by a task is
+ * rethrown on the calling thread once the other tasks are finished.
+ *
+ * @param taskCount Number of task indices.
+ * @param maxWorkers Maximum number of threads working on this run, the calling thread included.
+ * @param task Function called with each index.
+ */
+void ThreadPool::run(std::size_t taskCount, unsigned maxWorkers, const std::function<void(std::size_t)> &task)
+{
+    struct Job {
+        std::function<void(std::size_t)> task;
+        std::size_t count;
+        std::atomic<std::size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t done = 0;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->task = task;
+    job->count = taskCount;
+
+    auto work = [job]() {
+        for (std::size_t index = job->next++; index < job->count; index = job->next++)
+        {
+            std::exception_ptr error;
+            try
+            {
+                job->task(index);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(job->mutex);
+            if (error && !job->error)
+            {
+                job->error = error;
+            }
+            if (++job->done == job->count)
+            {
+                job->finished.notify_all();
+            }
+        }
+    };
+
+    std::size_t helpers = std::min<std::size_t>({ static_cast<std::size_t>(std::max(1u, maxWorkers)) - 1, workers.size(),
+                                                  taskCount > 0 ? taskCount - 1 : 0 });
+    if (helpers > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::size_t i = 0; i < helpers; i++)
+            {
+                queue.push_back(work);
+            }
+        }
+        wake.notify_all();
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job]() { return job->done == job->count; });
+    if (job->error)
+    {
+        std::rethrow_exception(job->error);
+    }
+}
+
+/**
+ * @brief Returns the pool shared by every parallel scan, with one worker per additional hardware thread.
+ *
+ * @return ThreadPool& The process-wide pool, created on first use.
+ */
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+/**
+ * @brief Runs a function once for every chunk index, spread over a number of threads.
+ *
+ * Chunks are handed out dynamically by the shared ThreadPool, so the order in which they run is
+ * unspecified. Callers that need deterministic results store per-chunk output by index and combine
+ * it afterwards.
+ *
+ * @param chunkCount Number of chunks to process.
+ * @param threadCount Maximum number of threads to use; 1 runs every chunk on the calling thread.
+ * @param body Function called with each chunk index in [0, chunkCount).
+ */
+void parallelForChunks(std::size_t chunkCount, unsigned threadCount, const std::function<void(std::size_t)> &body)
+{
+    if (threadCount <= 1 || chunkCount <= 1)
+    {
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            body(chunk);
+        }
+        return;
+    }
+
+    ThreadPool::shared().run(chunkCount, threadCount, body);
+}
+
+/**
+ * @brief Reduces rows [0, count) in parallel with a result that does not depend on the thread count.
+ *
+ * The rows are cut into chunks of at least kReductionChunkSize rows, grown for large inputs so that no
+ * more than kMaxReductionChunks partials exist at once. The chunk size depends only on the row count,
+ * never on the number of threads. Each chunk is mapped to a partial result sequentially, and the partials are then merged
+ * in a fixed pairwise tree over the chunk indices. Threads only decide who computes a chunk, never
+ * how values are grouped or in which order they are combined, so floating point results are
+ * bit-identical whether one thread or many are used.
+ *
+ * @param count Number of rows.
+ * @param threadCount Maximum number of threads to use.
+ * @param map Function (begin, end) -> Partial reducing a row range sequentially.
+ * @param merge Function (Partial &into, const Partial &from) combining two adjacent partials.
+ * @return Partial The reduction of every row; a default constructed Partial if there are no rows.
+ */
+template <typename Partial, typename Map, typename Merge>
+Partial deterministicReduce(std::size_t count, unsigned threadCount, Map map, Merge merge)
+{
+    std::size_t chunkSize = std::max(kReductionChunkSize, (count + kMaxReductionChunks - 1) / kMaxReductionChunks);
+    std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 0)
+    {
+        return Partial();
+    }
+
+    std::vector<Partial> partials(chunkCount);
+    parallelForChunks(chunkCount, threadCount, [&](std::size_t chunk) {
+        std::size_t begin = chunk * chunkSize;
+        partials[chunk] = map(begin, std::min(count, begin + chunkSize));
+    });
+
+    for (std::size_t width = 1; width < chunkCount; width *= 2)
+    {
+        for (std::size_t i = 0; i + width < chunkCount; i += 2 * width)
+        {
+            merge(partials[i], partials[i + width]);
+        }
+    }
+    return partials[0];
+}
+
+/**
+ * @brief Sets the number of threads UserStats uses for its scans and reductions.
+ *
+ * Results are identical for any thread count.
+ *
+ * @param count Number of threads; 0 is treated as 1.
+ */
+void UserStats::setThreadCount(unsigned count)
+{
+    threadCount = std::max(1u, count);
+}
+
+/**
+ * @brief Maps a category label stored in UserInfo::bfp back to its category code.
+ *
+ * @param label The label, e.g. "Bmi: Normal" or "USNavy: Very High".
+ * @return BfpCategory The category code, or BfpCategory::Unknown for an empty or unrecognized label.
+ */
+BfpCategory categoryFromLabel(const std::string &label)
+{
+    std::size_t separator = label.find(": ");
+    std::string name = separator == std::string::npos ? label : label.substr(separator + 2);
+
+    if (name == "Low")
+    {
+        return BfpCategory::Low;
+    }
+    else if (name == "Normal")
+    {
+        return BfpCategory::Normal;
+    }
+    else if (name == "High")
+    {
+        return BfpCategory::High;
+    }
+    else if (name == "Very High")
+    {
+        return BfpCategory::VeryHigh;
+    }
+    return BfpCategory::Unknown;
+}
+
+/**
+ * @brief Reserves room for the given number of users in every column.
+ *
+ * @param count Number of users that will be appended.
+ */
+void UserTable::reserve(std::size_t count)
+{
+    names.reserve(count);
+    gender.reserve(count);
+    lifestyle.reserve(count);
+    category.reserve(count);
+    for (std::vector<double> &values : columns)
+    {
+        values.reserve(count);
+    }
+}
+
+/**
+ * @brief Appends a computed user to the table.
+ *
+ * @param user A pointer to the UserInfo object whose BFP, calories and macros have been computed.
+ */
+void UserTable::append(const UserInfo *user)
+{
+    names.push_back(user->name);
+    distinctNames.add(hashName(user->name));
+    gender.push_back(genderFromString(user->gender));
+    lifestyle.push_back(lifestyleFromString(user->lifestyle));
+    category.push_back(categoryFromLabel(user->bfp.second));
+
+    columns[static_cast<std::size_t>(Column::Age)].push_back(user->age);
+    columns[static_cast<std::size_t>(Column::Weight)].push_back(user->weight);
+    columns[static_cast<std::size_t>(Column::Waist)].push_back(user->waist);
+    columns[static_cast<std::size_t>(Column::Neck)].push_back(user->neck);
+    columns[static_cast<std::size_t>(Column::Hip)].push_back(user->hip);
+    columns[static_cast<std::size_t>(Column::Height)].push_back(user->height);
+    columns[static_cast<std::size_t>(Column::Bfp)].push_back(user->bfp.first);
+    columns[static_cast<std::size_t>(Column::Bmi)].push_back(user->height > 0 ? (user->weight * 100 * 100) / (user->height * user->height) : 0.0);
+    columns[static_cast<std::size_t>(Column::DailyCalories)].push_back(user->daily_calories);
+    columns[static_cast<std::size_t>(Column::Carbs)].push_back(user->carbs);
+    columns[static_cast<std::size_t>(Column::Protein)].push_back(user->protein);
+    columns[static_cast<std::size_t>(Column::Fat)].push_back(user->fat);
+}
+
+/**
+ * @brief Returns the computed table for a data file, loading it only if it changed since the last call.
+ *
+ * Loaded tables are cached by (path, method) together with the file size and modification time seen
+ * when they were loaded. As long as both are unchanged the cached table is returned as is, so repeated
+ * queries only pay for their filter. A changed file is reloaded and recomputed in full.
+ *
+ * @param filename The name of the file containing user information.
+ * @param bfpType The type of method used to compute body fat percentage.
+ * @return A shared pointer to the computed table; it stays valid even if the cache entry is replaced later.
+ * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ */
+std::shared_ptr<const UserTable> UserStats::loadTable(const std::string &filename, BfpType bfpType)
+{
+    std::error_code sizeError, timeError;
+    std::uintmax_t fileSize = std::filesystem::file_size(filename, sizeError);
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(filename, timeError);
+    const bool cacheable = !sizeError && !timeError;
+
+    auto key = std::make_pair(filename, bfpType);
+    auto it = datasetCache.find(key);
+    if (cacheable && it != datasetCache.end() && it->second.fileSize == fileSize && it->second.modified == modified)
+    {
+        return it->second.table;
+    }
+
+    std::shared_ptr<std::vector<UserInfo*>> users = massLoadAndCompute(filename, bfpType);
+    std::shared_ptr<UserTable> table = std::make_shared<UserTable>();
+    table->bfpType = bfpType;
+    table->reserve(users->size());
+    for (UserInfo *user : *users)
+    {
+        table->append(user);
+        delete user;
+    }
+
+    if (cacheable)
+    {
+        datasetCache[key] = CachedDataset{ fileSize, modified, table };
+    }
+    return table;
+}
+
+/**
+ * @brief Drops every cached table so the next query reloads the data files.
+ */
+void UserStats::clearDatasetCache()
+{
+    datasetCache.clear();
+}
+
+/**
+ * @brief Builds a condition comparing a numeric column against a constant.
+ *
+ * @param column The column compared.
+ * @param op The comparison operator.
+ * @param value The constant compared against.
+ * @return Condition The condition.
+ */
+Condition Condition::on(Column column, CompareOp op, double value)
+{
+    Condition condition;
+    condition.field = Field::Numeric;
+    condition.column = column;
+    condition.op = op;
+    condition.value = value;
+    return condition;
+}
+
+/**
+ * @brief Builds a condition selecting users of a gender.
+ */
+Condition Condition::is(Gender gender)
+{
+    Condition condition;
+    condition.field = Field::Gender;
+    condition.value = static_cast<double>(gender);
+    return condition;
+}
+
+/**
+ * @brief Builds a condition selecting users of a lifestyle.
+ */
+Condition Condition::is(Lifestyle lifestyle)
+{
+    Condition condition;
+    condition.field = Field::Lifestyle;
+    condition.value = static_cast<double>(lifestyle);
+    return condition;
+}
+
+/**
+ * @brief Builds a condition selecting users of a body fat category.
+ */
+Condition Condition::is(BfpCategory category)
+{
+    Condition condition;
+    condition.field = Field::Category;
+    condition.value = static_cast<double>(category);
+    return condition;
+}
+
+/**
+ * @brief Builds a condition selecting users outside of a body fat category.
+ */
+Condition Condition::isNot(BfpCategory category)
+{
+    Condition condition = is(category);
+    condition.op = CompareOp::NotEqual;
+    return condition;
+}
+
+bool Condition::operator==(const Condition &other) const
+{
+    return field == other.field && (field != Field::Numeric || column == other.column) && op == other.op && value == other.value;
+}
+
+/**
+ * @brief Combines the accumulator of another, disjoint row range into this one.
+ *
+ * @param other The accumulator to merge in.
+ */
+void ColumnAccumulator::merge(const ColumnAccumulator &other)
+{
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    moments.merge(other.moments);
+}
+
+/**
+ * @brief Applies one comparison to a run of values, clearing the mask of the rows that fail it.
+ *
+ * The operator is resolved once per run so each loop is a plain compare-and-mask the compiler can vectorize.
+ *
+ * @param values First value of the run.
+ * @param count Number of values in the run.
+ * @param op The comparison operator.
+ * @param value The constant compared against.
+ * @param mask Selection mask of the run, one byte per row.
+ */
+template <typename T>
+void applyCondition(const T *values, std::size_t count, CompareOp op, T value, std::uint8_t *mask)
+{
+    switch (op)
+    {
+        case CompareOp::Equal:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] == value;
+            break;
+        case CompareOp::NotEqual:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] != value;
+            break;
+        case CompareOp::Less:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] < value;
+            break;
+        case CompareOp::LessEqual:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] <= value;
+            break;
+        case CompareOp::Greater:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] > value;
+            break;
+        case CompareOp::GreaterEqual:
+            for (std::size_t i = 0; i < count; i++) mask[i] &= values[i] >= value;
+            break;
+    }
+}
+
+/**
+ * @brief Applies a condition to the rows [begin, end) of a table, clearing the mask of the rows that fail it.
+ *
+ * @param table The table the condition is evaluated on.
+ * @param condition The condition.
+ * @param begin First row of the range.
+ * @param end One past the last row of the range.
+ * @param mask Selection mask of the range, one byte per row.
+ */
+void applyCondition(const UserTable *table, const Condition &condition, std::size_t begin, std::size_t end, std::uint8_t *mask)
+{
+    const std::size_t count = end - begin;
+    switch (condition.field)
+    {
+        case Field::Gender:
+            applyCondition(reinterpret_cast<const std::uint8_t*>(table->gender.data()) + begin, count, condition.op,
+                           static_cast<std::uint8_t>(condition.value), mask);
+            break;
+        case Field::Lifestyle:
+            applyCondition(reinterpret_cast<const std::uint8_t*>(table->lifestyle.data()) + begin, count, condition.op,
+                           static_cast<std::uint8_t>(condition.value), mask);
+            break;
+        case Field::Category:
+            applyCondition(reinterpret_cast<const std::uint8_t*>(table->category.data()) + begin, count, condition.op,
+                           static_cast<std::uint8_t>(condition.value), mask);
+            break;
+        case Field::Numeric:
+            applyCondition(table->column(condition.column).data() + begin, count, condition.op, condition.value, mask);
+            break;
+    }
+}
+
+/**
+ * @brief Adds an aggregate of a column over the rows matching all of the given conditions.
+ *
+ * @param op The aggregate to compute.
+ * @param column The column aggregated; ignored for AggregateOp::Count.
+ * @param where Conditions a row must satisfy to be aggregated; empty selects every row.
+ * @return std::size_t Index of the aggregate in the vector returned by run().
+ */
+std::size_t AggregateQuery::add(AggregateOp op, Column column, std::vector<Condition> where)
+{
+    if (op == AggregateOp::Count)
+    {
+        column = Column::Count;
+    }
+
+    std::size_t filter = std::find(filters.begin(), filters.end(), where) - filters.begin();
+    if (filter == filters.size())
+    {
+        filters.push_back(std::move(where));
+    }
+
+    std::size_t slot = 0;
+    while (slot < slots.size() && !(slots[slot].filter == filter && slots[slot].column == column))
+    {
+        slot++;
+    }
+    if (slot == slots.size())
+    {
+        slots.push_back(Slot{ filter, column });
+    }
+
+    specs.push_back(Spec{ op, slot });
+    return specs.size() - 1;
+}
+
+/**
+ * @brief Adds a count of the rows matching all of the given conditions.
+ *
+ * @param where Conditions a row must satisfy to be counted; empty counts every row.
+ * @return std::size_t Index of the count in the vector returned by run().
+ */
+std::size_t AggregateQuery::count(std::vector<Condition> where)
+{
+    return add(AggregateOp::Count, Column::Count, std::move(where));
+}
+
+/**
+ * @brief Accumulates every slot over the rows [begin, end) of a table.
+ *
+ * The selection mask of each distinct filter is built once for the range, then every slot
+ * using that filter is fed from it while the range is still in cache.
+ *
+ * @param table The table scanned.
+ * @param begin First row of the range.
+ * @param end One past the last row of the range.
+ * @return std::vector<ColumnAccumulator> One accumulator per slot.
+ */
+std::vector<ColumnAccumulator> AggregateQuery::scan(const UserTable &table, std::size_t begin, std::size_t end) const
+{
+    const std::size_t count = end - begin;
+    std::vector<ColumnAccumulator> accumulators(slots.size());
+    std::vector<std::uint8_t> mask(count);
+
+    for (std::size_t filter = 0; filter < filters.size(); filter++)
+    {
+        std::fill(mask.begin(), mask.end(), 1);
+        for (const Condition &condition : filters[filter])
+        {
+            applyCondition(&table, condition, begin, end, mask.data());
+        }
+
+        for (std::size_t slot = 0; slot < slots.size(); slot++)
+        {
+            if (slots[slot].filter != filter)
+            {
+                continue;
+            }
+
+            ColumnAccumulator &accumulator = accumulators[slot];
+            if (slots[slot].column == Column::Count)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    accumulator.count += mask[i];
+                }
+                continue;
+            }
+
+            const double *values = table.column(slots[slot].column).data() + begin;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (mask[i])
+                {
+                    accumulator.count++;
+                    accumulator.sum += values[i];
+                    accumulator.min = std::min(accumulator.min, values[i]);
+                    accumulator.max = std::max(accumulator.max, values[i]);
+                    accumulator.moments.add(values[i]);
+                }
+            }
+        }
+    }
+
+    return accumulators;
+}
+
+/**
+ * @brief Evaluates every aggregate over the given tables in one scan of each.
+ *
+ * The scan goes through deterministicReduce, so the results do not depend on the thread count.
+ * Tables are combined in the order given. Mean, variance, min and max of an empty selection are
+ * NaN, so an empty selection is not mistaken for a real zero.
+ *
+ * @param tables The tables scanned, typically one per data file.
+ * @param threadCount Maximum number of threads to use.
+ * @return std::vector<double> One value per aggregate, in the order they were added.
+ */
+std::vector<double> AggregateQuery::run(const std::vector<std::shared_ptr<const UserTable>> &tables, unsigned threadCount) const
+{
+    auto merge = [](std::vector<ColumnAccumulator> &into, const std::vector<ColumnAccumulator> &from) {
+        if (into.empty())
+        {
+            into = from;
+            return;
+        }
+        for (std::size_t slot = 0; slot < from.size(); slot++)
+        {
+            into[slot].merge(from[slot]);
+        }
+    };
+
+    std::vector<ColumnAccumulator> accumulators(slots.size());
+    for (const std::shared_ptr<const UserTable> &table : tables)
+    {
+        merge(accumulators, deterministicReduce<std::vector<ColumnAccumulator>>(table->size(), threadCount,
+            [&](std::size_t begin, std::size_t end) { return scan(*table, begin, end); }, merge));
+    }
+
+    std::vector<double> results;
+    for (const Spec &spec : specs)
+    {
+        const ColumnAccumulator &accumulator = accumulators[spec.slot];
+        switch (spec.op)
+        {
+            case AggregateOp::Count:
+                results.push_back(accumulator.count);
+                break;
+            case AggregateOp::Sum:
+                results.push_back(accumulator.sum);
+                break;
+            case AggregateOp::Mean:
+                results.push_back(accumulator.count ? accumulator.moments.mean : std::nan(""));
+                break;
+            case AggregateOp::Min:
+                results.push_back(accumulator.count ? accumulator.min : std::nan(""));
+                break;
+            case AggregateOp::Max:
+                results.push_back(accumulator.count ? accumulator.max : std::nan(""));
+                break;
+            case AggregateOp::Variance:
+                results.push_back(accumulator.count ? accumulator.moments.variance() : std::nan(""));
+                break;
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief Tells whether any aggregate or condition of the query reads a column.
+ *
+ * @param column The column looked for.
+ * @return true if the column is aggregated or compared in a filter.
+ */
+bool AggregateQuery::reads(Column column) const
+{
+    for (const Slot &slot : slots)
+    {
+        if (slot.column == column)
+        {
+            return true;
+        }
+    }
+    for (const std::vector<Condition> &filter : filters)
+    {
+        for (const Condition &condition : filter)
+        {
+            if (condition.field == Field::Numeric && condition.column == column)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the tables a method name refers to.
+ *
+ * @param method "bmi", "USArmy", or anything else for both data files.
+ * @return std::vector<std::shared_ptr<const UserTable>> The cached tables of the data files.
+ */
+std::vector<std::shared_ptr<const UserTable>> UserStats::loadTables(const std::string &method)
+{
+    if (method == "bmi")
+    {
+        return { loadTable("bmi_user_data.csv", BfpType::BmiMethod) };
+    }
+    else if (method == "USArmy")
+    {
+        return { loadTable("us_user_data.csv", BfpType::USNavyMethod) };
+    }
+    return { loadTable("bmi_user_data.csv", BfpType::BmiMethod), loadTable("us_user_data.csv", BfpType::USNavyMethod) };
+}
+
+/**
+ * @brief Evaluates an aggregate query over the data file(s) of a method.
+ *
+ * Usage example:
+ * AggregateQuery query;
+ * std::size_t meanBfp = query.add(AggregateOp::Mean, Column::Bfp, { Condition::is(Gender::Female) });
+ * double value = stats.GetAggregates("bmi", query)[meanBfp];
+ *
+ * The Bfp column holds BMI values in the BMI data file and body fat percentages in the US Navy one,
+ * so a query reading it must name one method; "all" is only accepted for the other columns.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param query The aggregates to compute.
+ * @return std::vector<double> One value per aggregate of the query.
+ * @throws std::runtime_error if method is "all" and the query reads the Bfp column.
+ */
+std::vector<double> UserStats::GetAggregates(std::string method, const AggregateQuery &query)
+{
+    std::vector<std::shared_ptr<const UserTable>> tables = loadTables(method);
+    if (tables.size() > 1 && query.reads(Column::Bfp))
+    {
+        throw std::runtime_error("Cannot aggregate bfp over both methods, query \"bmi\" and \"USArmy\" separately");
+    }
+    return query.run(tables, threadCount);
+}
+
+/**
+ * @brief Maps an age to the bracket used by the US Navy categories.
+ *
+ * @param age Age of the user in years.
+ * @return AgeBracket The bracket, or AgeBracket::Other outside of 20-79.
+ */
+AgeBracket ageBracketOf(int age)
+{
+    if (age < 20 || age > 79)
+    {
+        return AgeBracket::Other;
+    }
+    return static_cast<AgeBracket>(1 + (age - 20) / 20);
+}
+
+/**
+ * @brief Helper function returning the display name of a gender code.
+ */
+std::string genderName(Gender gender)
+{
+    switch (gender)
+    {
+        case Gender::Male: return "male";
+        case Gender::Female: return "female";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Helper function returning the display name of a lifestyle code.
+ */
+std::string lifestyleName(Lifestyle lifestyle)
+{
+    switch (lifestyle)
+    {
+        case Lifestyle::Sedentary: return "sedentary";
+        case Lifestyle::Moderate: return "moderate";
+        case Lifestyle::Active: return "active";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Helper function returning the display name of a body fat category, without method prefix.
+ */
+std::string categoryName(BfpCategory category)
+{
+    switch (category)
+    {
+        case BfpCategory::Low: return "Low";
+        case BfpCategory::Normal: return "Normal";
+        case BfpCategory::High: return "High";
+        case BfpCategory::VeryHigh: return "Very High";
+        default: return "Unknown";
+    }
+}
+
+/**
+ * @brief Helper function returning the display name of an age bracket.
+ */
+std::string ageBracketName(AgeBracket bracket)
+{
+    switch (bracket)
+    {
+        case AgeBracket::Age20To39: return "20-39";
+        case AgeBracket::Age40To59: return "40-59";
+        case AgeBracket::Age60To79: return "60-79";
+        default: return "other";
+    }
+}
+
+/**
+ * @brief Computes a cross-tab of users by method x gender x age bracket x lifestyle x category.
+ *
+ * The method is a dimension because BFP and category mean different things for the BMI and the
+ * US Navy method, and a user present in both data files belongs to one group of each method.
+ * The five dimensions have 2 x 3 x 4 x 4 x 5 values, so every group has a fixed slot in a dense array
+ * and grouping a row is a few multiply-adds instead of a hash lookup. Rows are scanned once; each
+ * chunk of the table fills its own partial array, worked on by whichever thread picked the chunk,
+ * and the partial arrays are merged through deterministicReduce. Only non-empty groups are returned
+ * and printed, ordered by method, gender, age bracket, lifestyle and category; the method is only
+ * printed for "all".
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param where Conditions a user must satisfy to be counted; empty counts every user.
+ * @return std::vector<GroupStats> The count, mean BFP and mean calories of every non-empty group.
+ */
+std::vector<GroupStats> UserStats::GetCrossTab(std::string method, std::vector<Condition> where)
+{
+    const std::size_t lifestyles = 4, categories = 5;
+    const std::size_t methodGroups = 3 * 4 * lifestyles * categories;
+    const std::size_t groupCount = 2 * methodGroups;
+
+    struct GroupSums {
+        std::size_t count = 0;
+        double bfp = 0.0;
+        double calories = 0.0;
+    };
+    auto merge = [](std::vector<GroupSums> &into, const std::vector<GroupSums> &from) {
+        if (into.empty())
+        {
+            into = from;
+            return;
+        }
+        for (std::size_t group = 0; group < from.size(); group++)
+        {
+            into[group].count += from[group].count;
+            into[group].bfp += from[group].bfp;
+            into[group].calories += from[group].calories;
+        }
+    };
+
+    std::vector<GroupSums> sums(groupCount);
+    std::vector<std::shared_ptr<const UserTable>> tables = loadTables(method);
+    for (const std::shared_ptr<const UserTable> &table : tables)
+    {
+        const std::vector<double> &age = table->column(Column::Age);
+        const std::vector<double> &bfp = table->column(Column::Bfp);
+        const std::vector<double> &calories = table->column(Column::DailyCalories);
+        const std::size_t methodOffset = table->bfpType == BfpType::USNavyMethod ? methodGroups : 0;
+
+        merge(sums, deterministicReduce<std::vector<GroupSums>>(table->size(), threadCount,
+            [&](std::size_t begin, std::size_t end) {
+                std::vector<GroupSums> partial(groupCount);
+                std::vector<std::uint8_t> mask(end - begin, 1);
+                for (const Condition &condition : where)
+                {
+                    applyCondition(table.get(), condition, begin, end, mask.data());
+                }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if (!mask[i - begin])
+                    {
+                        continue;
+                    }
+                    std::size_t group = methodOffset + ((static_cast<std::size_t>(table->gender[i]) * 4
+                                        + static_cast<std::size_t>(ageBracketOf(static_cast<int>(age[i])))) * lifestyles
+                                        + static_cast<std::size_t>(table->lifestyle[i])) * categories
+                                        + static_cast<std::size_t>(table->category[i]);
+                    partial[group].count++;
+                    partial[group].bfp += bfp[i];
+                    partial[group].calories += calories[i];
+                }
+                return partial;
+            }, merge));
+    }
+
+    std::vector<GroupStats> groups;
+    std::cout << "Cross Tab (" << method << " method): " << (tables.size() > 1 ? "method, " : "")
+              << "gender, age, lifestyle, category" << std::endl;
+    for (std::size_t group = 0; group < groupCount; group++)
+    {
+        if (sums[group].count == 0)
+        {
+            continue;
+        }
+
+        GroupStats stats;
+        stats.method = group < methodGroups ? BfpType::BmiMethod : BfpType::USNavyMethod;
+        stats.category = static_cast<BfpCategory>(group % categories);
+        stats.lifestyle = static_cast<Lifestyle>(group / categories % lifestyles);
+        stats.ageBracket = static_cast<AgeBracket>(group / (categories * lifestyles) % 4);
+        stats.gender = static_cast<Gender>(group % methodGroups / (categories * lifestyles * 4));
+        stats.count = sums[group].count;
+        stats.meanBfp = sums[group].bfp / sums[group].count;
+        stats.meanCalories = sums[group].calories / sums[group].count;
+        groups.push_back(stats);
+
+        if (tables.size() > 1)
+        {
+            std::cout << (stats.method == BfpType::BmiMethod ? "bmi, " : "USArmy, ");
+        }
+        std::cout << genderName(stats.gender) << ", " << ageBracketName(stats.ageBracket) << ", "
+                  << lifestyleName(stats.lifestyle) << ", " << categoryName(stats.category) << ": "
+                  << stats.count << " users, mean bfp " << double_to_string(stats.meanBfp, 2)
+                  << ", mean calories " << double_to_string(stats.meanCalories, 2) << std::endl;
+    }
+
+    return groups;
+}
+
+/**
+ * @brief Helper function returning the display name of a column.
+ */
+std::string columnName(Column column)
+{
+    switch (column)
+    {
+        case Column::Age: return "age";
+        case Column::Weight: return "weight";
+        case Column::Waist: return "waist";
+        case Column::Neck: return "neck";
+        case Column::Hip: return "hip";
+        case Column::Height: return "height";
+        case Column::Bfp: return "bfp";
+        case Column::Bmi: return "bmi";
+        case Column::DailyCalories: return "daily_calories";
+        case Column::Carbs: return "carbs";
+        case Column::Protein: return "protein";
+        case Column::Fat: return "fat";
+        default: return "count";
+    }
+}
+
+/**
+ * @brief Constructs an empty sketch.
+ *
+ * @param k Capacity of the top compactor; larger values trade memory for accuracy.
+ */
+QuantileSketch::QuantileSketch(std::size_t k) : k(std::max<std::size_t>(k, 8)), levels(1)
+{
+}
+
+/**
+ * @brief Returns the capacity of a level; lower levels shrink geometrically by 2/3, down to 2 items.
+ */
+std::size_t QuantileSketch::capacity(std::size_t level) const
+{
+    std::size_t depth = levels.size() - 1 - level;
+    return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+}
+
+/**
+ * @brief Compacts levels that exceed their capacity until every level fits.
+ */
+void QuantileSketch::compress()
+{
+    for (std::size_t level = 0; level < levels.size(); level++)
+    {
+        if (levels[level].size() < capacity(level))
+        {
+            continue;
+        }
+        if (level + 1 == levels.size())
+        {
+            levels.emplace_back();
+        }
+
+        std::vector<double> &items = levels[level];
+        std::sort(items.begin(), items.end());
+
+        // An odd item out stays at this level so the total weight is preserved
+        double leftover = 0.0;
+        bool hasLeftover = items.size() % 2 == 1;
+        if (hasLeftover)
+        {
+            leftover = items.back();
+            items.pop_back();
+        }
+
+        std::size_t offset = compactions++ % 2;
+        for (std::size_t i = offset; i < items.size(); i += 2)
+        {
+            levels[level + 1].push_back(items[i]);
+        }
+        items.clear();
+        if (hasLeftover)
+        {
+            items.push_back(leftover);
+        }
+    }
+}
+
+/**
+ * @brief Adds a value to the sketch.
+ *
+ * @param value The value to add.
+ */
+void QuantileSketch::add(double value)
+{
+    levels[0].push_back(value);
+    n++;
+    if (levels[0].size() >= capacity(0))
+    {
+        compress();
+    }
+}
+
+/**
+ * @brief Combines the sketch of another, disjoint stream into this one.
+ *
+ * @param other The sketch to merge in.
+ */
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.levels.size() > levels.size())
+    {
+        levels.resize(other.levels.size());
+    }
+    for (std::size_t level = 0; level < other.levels.size(); level++)
+    {
+        levels[level].insert(levels[level].end(), other.levels[level].begin(), other.levels[level].end());
+    }
+    n += other.n;
+    compress();
+}
+
+/**
+ * @brief Returns an approximate quantile of the values added so far.
+ *
+ * @param q The quantile, between 0 and 1 (0.5 for the median).
+ * @return double The value at that rank, or NaN if the sketch is empty.
+ */
+double QuantileSketch::quantile(double q) const
+{
+    std::vector<std::pair<double, std::size_t>> weighted;
+    for (std::size_t level = 0; level < levels.size(); level++)
+    {
+        for (double value : levels[level])
+        {
+            weighted.emplace_back(value, std::size_t(1) << level);
+        }
+    }
+    if (weighted.empty())
+    {
+        return std::nan("");
+    }
+
+    std::sort(weighted.begin(), weighted.end());
+    std::size_t total = 0;
+    for (const auto &item : weighted)
+    {
+        total += item.second;
+    }
+
+    double target = std::min(std::max(q, 0.0), 1.0) * total;
+    std::size_t cumulative = 0;
+    for (const auto &item : weighted)
+    {
+        cumulative += item.second;
+        if (cumulative >= target)
+        {
+            return item.first;
+        }
+    }
+    return weighted.back().first;
+}
+
+/**
+ * @brief Constructs an empty histogram.
+ *
+ * @param low Lower bound of the first bucket.
+ * @param high Upper bound of the last bucket.
+ * @param buckets Number of equal-width buckets between low and high.
+ */
+FixedHistogram::FixedHistogram(double low, double high, std::size_t buckets)
+    : low(low), width((high - low) / std::max<std::size_t>(buckets, 1)), bucketCounts(std::max<std::size_t>(buckets, 1), 0)
+{
+}
+
+/**
+ * @brief Counts a value in its bucket, or in the underflow/overflow counts if it is out of range.
+ *
+ * @param value The value to count.
+ */
+void FixedHistogram::add(double value)
+{
+    if (value < low)
+    {
+        below++;
+        return;
+    }
+
+    std::size_t bucket = static_cast<std::size_t>((value - low) / width);
+    if (bucket >= bucketCounts.size())
+    {
+        above++;
+        return;
+    }
+    bucketCounts[bucket]++;
+}
+
+/**
+ * @brief Adds the counts of another histogram with the same range and buckets.
+ *
+ * @param other The histogram to merge in.
+ */
+void FixedHistogram::merge(const FixedHistogram &other)
+{
+    for (std::size_t bucket = 0; bucket < bucketCounts.size() && bucket < other.bucketCounts.size(); bucket++)
+    {
+        bucketCounts[bucket] += other.bucketCounts[bucket];
+    }
+    below += other.below;
+    above += other.above;
+}
+
+/**
+ * @brief Computes p10/p50/p90/p99 and a histogram of a column for every method x gender x age bracket cohort.
+ *
+ * Nothing is sorted: each chunk of the table streams its rows into one quantile sketch and one
+ * histogram per cohort, and the per-chunk results are merged through deterministicReduce. The
+ * histogram uses a fixed range per column (BFP 0-60, BMI 10-50, weight 30-180 kg, calories
+ * 1000-3500, otherwise 0-250); values outside of it are reported as underflow/overflow.
+ * Cohorts are split by method since the BFP column holds BMI values for one method and body fat
+ * percentages for the other. Non-empty cohorts are printed and returned ordered by method, gender
+ * and age bracket; the method is only printed for "all".
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param column The column to describe.
+ * @param buckets Number of histogram buckets.
+ * @return std::vector<CohortDistribution> The sketch and histogram of every non-empty cohort.
+ */
+std::vector<CohortDistribution> UserStats::GetDistribution(std::string method, Column column, std::size_t buckets)
+{
+    const std::size_t brackets = 4;
+    const std::size_t methodCohorts = 3 * brackets;
+    const std::size_t cohortCount = 2 * methodCohorts;
+
+    double low = 0.0, high = 250.0;
+    if (column == Column::Bfp)
+    {
+        low = 0.0, high = 60.0;
+    }
+    else if (column == Column::Bmi)
+    {
+        low = 10.0, high = 50.0;
+    }
+    else if (column == Column::Weight)
+    {
+        low = 30.0, high = 180.0;
+    }
+    else if (column == Column::DailyCalories)
+    {
+        low = 1000.0, high = 3500.0;
+    }
+
+    auto makeCohorts = [&]() {
+        std::vector<CohortDistribution> cohorts(cohortCount);
+        for (std::size_t cohort = 0; cohort < cohortCount; cohort++)
         {
-            if (bfp < 21)
+            cohorts[cohort].method = cohort < methodCohorts ? BfpType::BmiMethod : BfpType::USNavyMethod;
+            cohorts[cohort].gender = static_cast<Gender>(cohort % methodCohorts / brackets);
+            cohorts[cohort].ageBracket = static_cast<AgeBracket>(cohort % brackets);
+            cohorts[cohort].histogram = FixedHistogram(low, high, buckets);
+        }
+        return cohorts;
+    };
+    auto merge = [](std::vector<CohortDistribution> &into, const std::vector<CohortDistribution> &from) {
+        for (std::size_t cohort = 0; cohort < into.size() && cohort < from.size(); cohort++)
+        {
+            into[cohort].sketch.merge(from[cohort].sketch);
+            into[cohort].histogram.merge(from[cohort].histogram);
+        }
+    };
+
+    std::vector<CohortDistribution> cohorts = makeCohorts();
+    std::vector<std::shared_ptr<const UserTable>> tables = loadTables(method);
+    for (const std::shared_ptr<const UserTable> &table : tables)
+    {
+        const std::vector<double> &age = table->column(Column::Age);
+        const std::vector<double> &values = table->column(column);
+        const std::size_t methodOffset = table->bfpType == BfpType::USNavyMethod ? methodCohorts : 0;
+
+        std::vector<CohortDistribution> partial = deterministicReduce<std::vector<CohortDistribution>>(table->size(), threadCount,
+            [&](std::size_t begin, std::size_t end) {
+                std::vector<CohortDistribution> chunk = makeCohorts();
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    std::size_t cohort = methodOffset + static_cast<std::size_t>(table->gender[i]) * brackets
+                                       + static_cast<std::size_t>(ageBracketOf(static_cast<int>(age[i])));
+                    chunk[cohort].sketch.add(values[i]);
+                    chunk[cohort].histogram.add(values[i]);
+                }
+                return chunk;
+            }, merge);
+        merge(cohorts, partial);
+    }
+
+    std::vector<CohortDistribution> result;
+    std::cout << "Distribution of " << columnName(column) << " (" << method << " method):" << std::endl;
+    for (CohortDistribution &cohort : cohorts)
+    {
+        if (cohort.sketch.count() == 0)
+        {
+            continue;
+        }
+
+        if (tables.size() > 1)
+        {
+            std::cout << (cohort.method == BfpType::BmiMethod ? "bmi, " : "USArmy, ");
+        }
+        std::cout << genderName(cohort.gender) << ", " << ageBracketName(cohort.ageBracket) << ": "
+                  << cohort.sketch.count() << " users, p10 " << double_to_string(cohort.sketch.quantile(0.10), 2)
+                  << ", p50 " << double_to_string(cohort.sketch.quantile(0.50), 2)
+                  << ", p90 " << double_to_string(cohort.sketch.quantile(0.90), 2)
+                  << ", p99 " << double_to_string(cohort.sketch.quantile(0.99), 2) << std::endl;
+        const std::vector<std::size_t> &counts = cohort.histogram.counts();
+        for (std::size_t bucket = 0; bucket < counts.size(); bucket++)
+        {
+            std::cout << "  [" << double_to_string(cohort.histogram.bucketLow(bucket), 2) << ", "
+                      << double_to_string(cohort.histogram.bucketHigh(bucket), 2) << "): " << counts[bucket] << std::endl;
+        }
+        if (cohort.histogram.underflow() || cohort.histogram.overflow())
+        {
+            std::cout << "  below range: " << cohort.histogram.underflow() << ", above range: " << cohort.histogram.overflow() << std::endl;
+        }
+        result.push_back(std::move(cohort));
+    }
+
+    return result;
+}
+
+/**
+ * @brief Adds (sign = 1) or removes (sign = -1) the contribution of a user to the statistics.
+ *
+ * The method is the one recorded in UserInfo::bfpType when the BFP was computed. US Navy users
+ * outside of its age table have no category label and count as computed with BfpCategory::Unknown.
+ *
+ * @param user A pointer to the UserInfo object to account for.
+ * @param sign 1 when the user enters the population, -1 when it leaves it.
+ */
+void LiveStats::account(const UserInfo *user, int sign)
+{
+    std::size_t gender = static_cast<std::size_t>(genderFromString(user->gender));
+    std::size_t method = !user->bfpType ? 0 : *user->bfpType == BfpType::BmiMethod ? 1 : 2;
+    std::size_t category = static_cast<std::size_t>(categoryFromLabel(user->bfp.second));
+
+    users += sign;
+    byGender[gender] += sign;
+    byCategory[method][category][gender] += sign;
+    weightGrams += sign * std::llround(user->weight * 1000.0);
+    if (method != 0)
+    {
+        computedUsers += sign;
+        bfpSum += sign * user->bfp.first;
+    }
+    if (user->daily_calories != 0)
+    {
+        caloriesUsers += sign;
+        caloriesSum += sign * user->daily_calories;
+    }
+}
+
+/**
+ * @brief Returns the number of users of a category for a method.
+ *
+ * @param bfpType The method the category was computed with.
+ * @param category The body fat category.
+ * @return std::size_t The number of users, all genders combined.
+ */
+std::size_t LiveStats::count(BfpType bfpType, BfpCategory category) const
+{
+    std::size_t total = 0;
+    for (std::size_t gender = 0; gender < 3; gender++)
+    {
+        total += count(bfpType, category, static_cast<Gender>(gender));
+    }
+    return total;
+}
+
+/**
+ * @brief Returns the number of users of a category and gender for a method.
+ *
+ * @param bfpType The method the category was computed with.
+ * @param category The body fat category.
+ * @param gender The gender.
+ * @return std::size_t The number of users.
+ */
+std::size_t LiveStats::count(BfpType bfpType, BfpCategory category, Gender gender) const
+{
+    std::size_t method = bfpType == BfpType::BmiMethod ? 1 : 2;
+    return byCategory[method][static_cast<std::size_t>(category)][static_cast<std::size_t>(gender)];
+}
+
+/**
+ * @brief Looks up a user and runs a computation on it under one exclusive lock.
+ *
+ * The user's old contribution is removed before the computation and its new one added after it,
+ * so the statistics stay exact in O(1) however many users the manager holds. The lookup uses the
+ * name indexes of the snapshot, and publishing copies only this user and rebuilds only its segment.
+ * The user cannot be deleted between the lookup and the computation.
+ *
+ * @param username The username of the user to recompute.
+ * @param compute The computation updating the user's BFP, calories or macros.
+ * @return true if the user was found and recomputed.
+ */
+bool UserInfoManager::recompute(const std::string &username, const std::function<void(UserInfo*)> &compute)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::size_t index = lookupUser(username);
+    if (index == userInfoList.size())
+    {
+        return false;
+    }
+
+    recomputeUser(userInfoList[index], compute);
+    changedUsers.push_back(index);
+    publish();
+    return true;
+}
+
+/**
+ * @brief Runs a computation on a user, moving its contribution to the statistics; the caller holds the lock.
+ *
+ * @param userInfo A pointer to the UserInfo object to recompute; nothing happens if it is nullptr.
+ * @param compute The computation updating the user's BFP, calories or macros.
+ */
+void UserInfoManager::recomputeUser(UserInfo *userInfo, const std::function<void(UserInfo*)> &compute)
+{
+    if (userInfo == nullptr)
+    {
+        return;
+    }
+
+    liveStats.account(userInfo, -1);
+    compute(userInfo);
+    liveStats.account(userInfo, 1);
+}
+
+/**
+ * @brief Returns the incrementally maintained population statistics.
+ *
+ * @return LiveStats A copy of the statistics, read in O(1).
+ */
+LiveStats UserInfoManager::getLiveStats() const
+{
+    return snapshot().liveStats();
+}
+
+/**
+ * @brief Wrapper method to read the population statistics of UserInfoManager.
+ *
+ * @return LiveStats A copy of the statistics, read in O(1).
+ */
+LiveStats HealthAssistant::getLiveStats() const
+{
+    return userInfoManager->getLiveStats();
+}
+
+/**
+ * @class FilterProgram::Parser
+ * @brief Recursive descent parser emitting postfix instructions for FilterProgram.
+ *
+ * expression := term ('or' term)*
+ * term       := factor ('and' factor)*
+ * factor     := 'not' factor | '(' expression ')' | field operator value
+ */
+class FilterProgram::Parser
+{
+    public:
+        Parser(const std::string &text, FilterProgram &program) : text(text), program(program) {}
+
+        void parse()
+        {
+            next();
+            expression();
+            if (token.kind != Kind::End)
             {
-                category = "USNavy: Low";
+                fail("unexpected '" + token.text + "'");
             }
-            else if (bfp < 33)
+        }
+
+    private:
+        enum class Kind { End, Word, Number, String, Operator, Open, Close };
+        struct Token {
+            Kind kind = Kind::End;
+            std::string text;
+            std::size_t position = 0;
+        };
+
+        const std::string &text;
+        FilterProgram &program;
+        std::size_t position = 0;
+        std::size_t depth = 0;
+        Token token;
+
+        [[noreturn]] void fail(const std::string &message) const
+        {
+            throw std::runtime_error("Invalid filter expression at position " + std::to_string(token.position) + ": " + message);
+        }
+
+        void next()
+        {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
             {
-                category = "USNavy: Normal";
+                position++;
             }
-            else if (bfp < 39)
+
+            token = Token();
+            token.position = position;
+            if (position >= text.size())
             {
-                category = "USNavy: High";
+                return;
+            }
+
+            char c = text[position];
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+            {
+                std::size_t start = position;
+                while (position < text.size() && (std::isalnum(static_cast<unsigned char>(text[position])) || text[position] == '_'))
+                {
+                    position++;
+                }
+                token.kind = Kind::Word;
+                token.text = toLower(text.substr(start, position - start));
+            }
+            else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.' || c == '-')
+            {
+                std::size_t start = position++;
+                while (position < text.size() && (std::isdigit(static_cast<unsigned char>(text[position])) || text[position] == '.'))
+                {
+                    position++;
+                }
+                token.kind = Kind::Number;
+                token.text = text.substr(start, position - start);
+            }
+            else if (c == '"' || c == '\'')
+            {
+                std::size_t end = text.find(c, position + 1);
+                if (end == std::string::npos)
+                {
+                    fail("unterminated string");
+                }
+                token.kind = Kind::String;
+                token.text = toLower(text.substr(position + 1, end - position - 1));
+                position = end + 1;
+            }
+            else if (c == '(' || c == ')')
+            {
+                token.kind = c == '(' ? Kind::Open : Kind::Close;
+                token.text = std::string(1, c);
+                position++;
+            }
+            else if (c == '=' || c == '!' || c == '<' || c == '>')
+            {
+                std::size_t start = position++;
+                if (position < text.size() && text[position] == '=')
+                {
+                    position++;
+                }
+                token.kind = Kind::Operator;
+                token.text = text.substr(start, position - start);
             }
             else
             {
-                category = "USNavy: Very High";
+                fail(std::string("unexpected character '") + c + "'");
             }
         }
-        else if (user->age >= 40 && user->age <= 59)
+
+        void emit(OpCode code, Condition condition = Condition())
+        {
+            program.program.push_back(Instruction{ code, condition });
+            if (code == OpCode::Compare)
+            {
+                depth++;
+                program.stackDepth = std::max(program.stackDepth, depth);
+            }
+            else if (code != OpCode::Not)
+            {
+                depth--;
+            }
+        }
+
+        void expression()
+        {
+            term();
+            while (token.kind == Kind::Word && token.text == "or")
+            {
+                next();
+                term();
+                emit(OpCode::Or);
+            }
+        }
+
+        void term()
+        {
+            factor();
+            while (token.kind == Kind::Word && token.text == "and")
+            {
+                next();
+                factor();
+                emit(OpCode::And);
+            }
+        }
+
+        void factor()
+        {
+            if (token.kind == Kind::Word && token.text == "not")
+            {
+                next();
+                factor();
+                emit(OpCode::Not);
+            }
+            else if (token.kind == Kind::Open)
+            {
+                next();
+                expression();
+                if (token.kind != Kind::Close)
+                {
+                    fail("expected ')'");
+                }
+                next();
+            }
+            else
+            {
+                comparison();
+            }
+        }
+
+        void comparison()
+        {
+            if (token.kind != Kind::Word)
+            {
+                fail("expected a field name");
+            }
+            std::string field = token.text;
+            next();
+
+            if (token.kind != Kind::Operator || token.text == "!")
+            {
+                fail("expected a comparison operator after '" + field + "'");
+            }
+            CompareOp op = CompareOp::Equal;
+            if (token.text == "!=") op = CompareOp::NotEqual;
+            else if (token.text == "<") op = CompareOp::Less;
+            else if (token.text == "<=") op = CompareOp::LessEqual;
+            else if (token.text == ">") op = CompareOp::Greater;
+            else if (token.text == ">=") op = CompareOp::GreaterEqual;
+            next();
+
+            if (token.kind == Kind::End || token.kind == Kind::Operator || token.kind == Kind::Open || token.kind == Kind::Close)
+            {
+                fail("expected a value after '" + field + "'");
+            }
+            std::string value = token.text;
+            bool numeric = token.kind == Kind::Number;
+
+            Condition condition;
+            if (field == "gender" || field == "lifestyle" || field == "category")
+            {
+                if (op != CompareOp::Equal && op != CompareOp::NotEqual)
+                {
+                    fail("'" + field + "' only supports = and !=");
+                }
+
+                if (field == "gender")
+                {
+                    Gender gender = genderFromString(value);
+                    if (gender == Gender::Unknown) fail("unknown gender '" + value + "'");
+                    condition = Condition::is(gender);
+                }
+                else if (field == "lifestyle")
+                {
+                    Lifestyle lifestyle = lifestyleFromString(value == "moderately" ? "moderate" : value);
+                    if (lifestyle == Lifestyle::Unknown) fail("unknown lifestyle '" + value + "'");
+                    condition = Condition::is(lifestyle);
+                }
+                else
+                {
+                    BfpCategory category = BfpCategory::Unknown;
+                    if (value == "low") category = BfpCategory::Low;
+                    else if (value == "normal") category = BfpCategory::Normal;
+                    else if (value == "high") category = BfpCategory::High;
+                    else if (value == "very high" || value == "very_high" || value == "veryhigh") category = BfpCategory::VeryHigh;
+                    else if (value != "unknown") fail("unknown category '" + value + "'");
+                    condition = Condition::is(category);
+                }
+                condition.op = op;
+            }
+            else
+            {
+                static const std::vector<std::pair<std::string, Column>> columns = {
+                    { "age", Column::Age }, { "weight", Column::Weight }, { "waist", Column::Waist },
+                    { "neck", Column::Neck }, { "hip", Column::Hip }, { "height", Column::Height },
+                    { "bfp", Column::Bfp }, { "bmi", Column::Bmi }, { "calories", Column::DailyCalories },
+                    { "daily_calories", Column::DailyCalories }, { "carbs", Column::Carbs },
+                    { "protein", Column::Protein }, { "fat", Column::Fat },
+                };
+                auto it = std::find_if(columns.begin(), columns.end(), [&field](const std::pair<std::string, Column> &column) {
+                    return column.first == field;
+                });
+                if (it == columns.end())
+                {
+                    fail("unknown field '" + field + "'");
+                }
+                if (!numeric)
+                {
+                    fail("'" + field + "' must be compared against a number");
+                }
+                double number = 0.0;
+                std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), number);
+                if (result.ec != std::errc() || result.ptr != value.data() + value.size())
+                {
+                    fail("invalid number '" + value + "'");
+                }
+                condition = Condition::on(it->second, op, number);
+            }
+
+            next();
+            emit(OpCode::Compare, condition);
+        }
+};
+
+/**
+ * @brief Parses and compiles a filter expression.
+ *
+ * @param expression The filter, e.g. "gender=female and age>=40 and category!=normal and bmi<30".
+ * @return FilterProgram The compiled program, reusable for any number of queries.
+ * @throws std::runtime_error if the expression is not valid, with the position of the error.
+ */
+FilterProgram FilterProgram::compile(const std::string &expression)
+{
+    FilterProgram program;
+    program.expression = expression;
+    Parser(expression, program).parse();
+    return program;
+}
+
+/**
+ * @brief Evaluates the program over the rows [begin, end) of a table.
+ *
+ * @param table The table the program runs on.
+ * @param begin First row of the range.
+ * @param end One past the last row of the range.
+ * @param mask Receives one byte per row, 1 where the row matches.
+ */
+void FilterProgram::evaluate(const UserTable &table, std::size_t begin, std::size_t end, std::uint8_t *mask) const
+{
+    std::vector<std::uint8_t> stack;
+    evaluate(table, begin, end, mask, stack);
+}
+
+/**
+ * @brief Evaluates the program over the rows [begin, end) of a table, reusing an operand stack.
+ *
+ * Callers evaluating many blocks pass the same stack every time, so its masks are allocated once.
+ *
+ * @param table The table the program runs on.
+ * @param begin First row of the range.
+ * @param end One past the last row of the range.
+ * @param mask Receives one byte per row, 1 where the row matches.
+ * @param stack Scratch space for the operand masks, grown as needed.
+ */
+void FilterProgram::evaluate(const UserTable &table, std::size_t begin, std::size_t end, std::uint8_t *mask,
+                             std::vector<std::uint8_t> &stack) const
+{
+    const std::size_t count = end - begin;
+    if (stack.size() < stackDepth * count)
+    {
+        stack.resize(stackDepth * count);
+    }
+    auto operand = [&](std::size_t index) { return stack.data() + index * count; };
+    std::size_t top = 0;
+
+    for (const Instruction &instruction : program)
+    {
+        switch (instruction.code)
+        {
+            case OpCode::Compare:
+            {
+                std::fill(operand(top), operand(top) + count, 1);
+                applyCondition(&table, instruction.condition, begin, end, operand(top));
+                top++;
+                break;
+            }
+            case OpCode::And:
+            {
+                std::uint8_t *left = operand(top - 2);
+                const std::uint8_t *right = operand(top - 1);
+                for (std::size_t i = 0; i < count; i++) left[i] &= right[i];
+                top--;
+                break;
+            }
+            case OpCode::Or:
+            {
+                std::uint8_t *left = operand(top - 2);
+                const std::uint8_t *right = operand(top - 1);
+                for (std::size_t i = 0; i < count; i++) left[i] |= right[i];
+                top--;
+                break;
+            }
+            case OpCode::Not:
+            {
+                std::uint8_t *value = operand(top - 1);
+                for (std::size_t i = 0; i < count; i++) value[i] ^= 1;
+                break;
+            }
+        }
+    }
+
+    if (top == 0)
+    {
+        std::fill(mask, mask + count, 1);
+        return;
+    }
+    std::copy(operand(0), operand(0) + count, mask);
+}
+
+/**
+ * @brief Returns the ids of the rows of a table matching the program, in table order.
+ *
+ * Chunks of the table are evaluated in parallel and their matches concatenated in chunk order.
+ *
+ * @param table The table the program runs on.
+ * @param threadCount Maximum number of threads to use.
+ * @return std::vector<std::uint32_t> The matching row ids, ascending.
+ */
+std::vector<std::uint32_t> FilterProgram::select(const UserTable &table, unsigned threadCount) const
+{
+    return deterministicReduce<std::vector<std::uint32_t>>(table.size(), threadCount,
+        [&](std::size_t begin, std::size_t end) {
+            std::vector<std::uint32_t> rows;
+            std::vector<std::uint8_t> mask(end - begin);
+            std::vector<std::uint8_t> stack;
+            for (std::size_t block = begin; block < end; block += 1024)
+            {
+                std::size_t blockEnd = std::min(end, block + 1024);
+                evaluate(table, block, blockEnd, mask.data(), stack);
+                for (std::size_t i = block; i < blockEnd; i++)
+                {
+                    if (mask[i - block])
+                    {
+                        rows.push_back(static_cast<std::uint32_t>(i));
+                    }
+                }
+            }
+            return rows;
+        },
+        [](std::vector<std::uint32_t> &into, const std::vector<std::uint32_t> &from) {
+            into.insert(into.end(), from.begin(), from.end());
+        });
+}
+
+/**
+ * @brief Retrieves the names of the users matching a filter expression.
+ *
+ * Usage example:
+ * stats.Query("bmi", "gender=female and age>=40 and category!=normal and bmi<30");
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param expression The filter expression, see FilterProgram.
+ * @return A vector containing the names of the matching users.
+ * @throws std::runtime_error if the expression is not valid.
+ */
+std::vector<std::string> UserStats::Query(std::string method, std::string expression)
+{
+    return Query(method, FilterProgram::compile(expression));
+}
+
+/**
+ * @brief Retrieves the names of the users matching a compiled filter.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param filter The compiled filter, see FilterProgram.
+ * @return A vector containing the names of the matching users.
+ */
+std::vector<std::string> UserStats::Query(std::string method, const FilterProgram &filter)
+{
+    RowSet users = SelectUsers(method, filter);
+
+    std::cout << "Users matching '" << filter.text() << "' (" << method << " method):" << std::endl;
+    users.print(std::cout);
+
+    return users.toStrings();
+}
+
+/**
+ * @brief Selects the users matching a compiled filter without copying or printing their names.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param filter The compiled filter, see FilterProgram.
+ * @return RowSet The matching rows, in file order.
+ */
+RowSet UserStats::SelectUsers(std::string method, const FilterProgram &filter)
+{
+    RowSet users;
+    for (const std::shared_ptr<const UserTable> &table : loadTables(method))
+    {
+        users.add(table, filter.select(*table, threadCount));
+    }
+    return users;
+}
+
+/**
+ * @brief Finds the k best users of a column, overall or within each lifestyle, without sorting the table.
+ *
+ * Every chunk of a table keeps a bounded heap of its k best rows per group, so a chunk costs
+ * O(rows log k). The per-chunk winners are merged pairwise through deterministicReduce, keeping k per
+ * group. Ties are broken by table and row order, which makes the result deterministic.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param column The column users are ranked by.
+ * @param k Number of users kept per group.
+ * @param highest true for the largest values, false for the smallest.
+ * @param filter Optional filter expression (see FilterProgram); empty ranks every user.
+ * @param perLifestyle true for one ranking per Lifestyle code, false for a single ranking.
+ * @return std::vector<std::vector<RankedUser>> One best-first ranking per group.
+ */
+std::vector<std::vector<RankedUser>> UserStats::topUsers(const std::string &method, Column column, std::size_t k, bool highest,
+                                                         const std::string &filter, bool perLifestyle)
+{
+    struct Candidate {
+        double value;
+        std::uint32_t table;
+        std::uint32_t row;
+    };
+    using Groups = std::vector<std::vector<Candidate>>;
+
+    const std::size_t groupCount = perLifestyle ? 4 : 1;
+    // better(a, b) is true when a ranks before b
+    auto better = [highest](const Candidate &a, const Candidate &b) {
+        if (a.value != b.value)
+        {
+            return highest ? a.value > b.value : a.value < b.value;
+        }
+        return a.table != b.table ? a.table < b.table : a.row < b.row;
+    };
+    auto merge = [&](Groups &into, const Groups &from) {
+        if (from.empty())
         {
-            if (bfp < 23)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 34)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 40)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            return; // the default result of an empty table
         }
-        else if (user->age >= 60 && user->age <= 79)
+        if (into.empty())
         {
-            if (bfp < 24)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 36)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 42)
-            {
-                category = "USNavy: High";
-            }
-            else
+            into = from;
+            return;
+        }
+        for (std::size_t group = 0; group < groupCount; group++)
+        {
+            std::vector<Candidate> merged;
+            std::merge(into[group].begin(), into[group].end(), from[group].begin(), from[group].end(), std::back_inserter(merged), better);
+            if (merged.size() > k)
             {
-                category = "USNavy: Very High";
+                merged.resize(k);
             }
+            into[group] = std::move(merged);
         }
-        else
+    };
+
+    std::optional<FilterProgram> program;
+    if (!filter.empty())
+    {
+        program = FilterProgram::compile(filter);
+    }
+
+    std::vector<std::shared_ptr<const UserTable>> tables = loadTables(method);
+    Groups best(groupCount);
+    for (std::size_t t = 0; t < tables.size() && k > 0; t++)
+    {
+        const UserTable &table = *tables[t];
+        const std::vector<double> &values = table.column(column);
+
+        merge(best, deterministicReduce<Groups>(table.size(), threadCount,
+            [&](std::size_t begin, std::size_t end) {
+                Groups heaps(groupCount);
+                std::vector<std::uint8_t> mask(end - begin, 1);
+                if (program)
+                {
+                    program->evaluate(table, begin, end, mask.data());
+                }
+
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if (!mask[i - begin])
+                    {
+                        continue;
+                    }
+
+                    // Each heap keeps its worst candidate on top, ready to be evicted
+                    std::vector<Candidate> &heap = heaps[perLifestyle ? static_cast<std::size_t>(table.lifestyle[i]) : 0];
+                    Candidate candidate{ values[i], static_cast<std::uint32_t>(t), static_cast<std::uint32_t>(i) };
+                    if (heap.size() < k)
+                    {
+                        heap.push_back(candidate);
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                    else if (better(candidate, heap.front()))
+                    {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = candidate;
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                }
+
+                for (std::vector<Candidate> &heap : heaps)
+                {
+                    std::sort_heap(heap.begin(), heap.end(), better);
+                }
+                return heaps;
+            }, merge));
+    }
+
+    std::vector<std::vector<RankedUser>> rankings(groupCount);
+    for (std::size_t group = 0; group < groupCount; group++)
+    {
+        for (const Candidate &candidate : best[group])
         {
-            std::cout << "The body fat category cannot be determined because you are outside of the permitted age range." << std::endl;
+            const UserTable &table = *tables[candidate.table];
+            RankedUser user;
+            user.name = table.names[candidate.row];
+            user.bfpType = table.bfpType;
+            user.lifestyle = table.lifestyle[candidate.row];
+            user.value = candidate.value;
+            rankings[group].push_back(user);
         }
     }
-    else if (user->gender == "male")
+    return rankings;
+}
+
+/**
+ * @brief Retrieves the k users with the highest (or lowest) value of a computed column.
+ *
+ * Usage example:
+ * stats.GetTopUsers("all", Column::DailyCalories, 100, false); // lowest calorie targets
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param column The column users are ranked by.
+ * @param k Number of users to return.
+ * @param highest true for the largest values, false for the smallest.
+ * @param filter Optional filter expression (see FilterProgram); empty ranks every user.
+ * @return std::vector<RankedUser> The ranked users, best first.
+ * @throws std::runtime_error if the filter expression is not valid.
+ */
+std::vector<RankedUser> UserStats::GetTopUsers(std::string method, Column column, std::size_t k, bool highest, std::string filter)
+{
+    std::vector<RankedUser> ranking = topUsers(method, column, k, highest, filter, false)[0];
+
+    std::cout << "Top " << k << " Users by " << (highest ? "highest " : "lowest ") << columnName(column) << " (" << method << " method):" << std::endl;
+    for (const RankedUser &user : ranking)
     {
-        bfp = (495.0 / (1.0324 - 0.19077 * log10(user->waist - user->neck) + 0.15456 * log10(user->height))) - 450.0;
-        if (user->age >= 20 && user->age <= 39)
+        std::cout << user.name << ": " << double_to_string(user.value, 2) << std::endl;
+    }
+
+    return ranking;
+}
+
+/**
+ * @brief Retrieves the k users with the highest (or lowest) value of a computed column within each lifestyle.
+ *
+ * Usage example:
+ * stats.GetTopUsersPerLifestyle("USArmy", Column::Bfp, 100); // highest BFP per lifestyle
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param column The column users are ranked by.
+ * @param k Number of users to return per lifestyle.
+ * @param highest true for the largest values, false for the smallest.
+ * @param filter Optional filter expression (see FilterProgram); empty ranks every user.
+ * @return std::vector<std::vector<RankedUser>> One ranking per Lifestyle code, best first.
+ * @throws std::runtime_error if the filter expression is not valid.
+ */
+std::vector<std::vector<RankedUser>> UserStats::GetTopUsersPerLifestyle(std::string method, Column column, std::size_t k, bool highest, std::string filter)
+{
+    std::vector<std::vector<RankedUser>> rankings = topUsers(method, column, k, highest, filter, true);
+
+    for (std::size_t lifestyle = 0; lifestyle < rankings.size(); lifestyle++)
+    {
+        if (rankings[lifestyle].empty())
         {
-            if (bfp < 8)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 20)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 25)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            continue;
         }
-        else if (user->age >= 40 && user->age <= 59)
+
+        std::cout << "Top " << k << " " << lifestyleName(static_cast<Lifestyle>(lifestyle)) << " Users by "
+                  << (highest ? "highest " : "lowest ") << columnName(column) << " (" << method << " method):" << std::endl;
+        for (const RankedUser &user : rankings[lifestyle])
         {
-            if (bfp < 11)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 22)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 28)
+            std::cout << user.name << ": " << double_to_string(user.value, 2) << std::endl;
+        }
+    }
+
+    return rankings;
+}
+
+/**
+ * @brief Returns the ids of the rows of a table matching all of the given conditions, in table order.
+ *
+ * Chunks of the table are filtered in parallel on the shared ThreadPool and their matches are
+ * concatenated in chunk order, so the result is the same as a serial scan.
+ *
+ * @param table The table scanned.
+ * @param where Conditions a row must satisfy; empty selects every row.
+ * @return std::vector<std::uint32_t> The matching row ids, ascending.
+ */
+std::vector<std::uint32_t> UserStats::selectRows(const UserTable &table, const std::vector<Condition> &where)
+{
+    return deterministicReduce<std::vector<std::uint32_t>>(table.size(), threadCount,
+        [&](std::size_t begin, std::size_t end) {
+            std::vector<std::uint32_t> rows;
+            std::vector<std::uint8_t> mask(end - begin, 1);
+            for (const Condition &condition : where)
             {
-                category = "USNavy: High";
+                applyCondition(&table, condition, begin, end, mask.data());
             }
-            else
+            for (std::size_t i = begin; i < end; i++)
             {
-                category = "USNavy: Very High";
+                if (mask[i - begin])
+                {
+                    rows.push_back(static_cast<std::uint32_t>(i));
+                }
             }
+            return rows;
+        },
+        [](std::vector<std::uint32_t> &into, const std::vector<std::uint32_t> &from) {
+            into.insert(into.end(), from.begin(), from.end());
+        });
+}
+
+/**
+ * @brief Hashes a user name to 64 well-mixed bits.
+ *
+ * FNV-1a followed by a splitmix64 finalizer: stable across platforms and runs, unlike std::hash,
+ * so it can be used for sketches and anything persisted.
+ *
+ * @param name The name to hash.
+ * @return std::uint64_t The hash.
+ */
+std::uint64_t hashName(const std::string &name)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : name)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 30; hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27; hash *= 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+/**
+ * @brief Adds a hashed value to the sketch.
+ *
+ * @param hash A well-mixed 64-bit hash of the value, e.g. from hashName().
+ */
+void HyperLogLog::add(std::uint64_t hash)
+{
+    std::size_t index = hash >> (64 - kPrecision);
+    std::uint64_t rest = (hash << kPrecision) | (std::uint64_t(1) << (kPrecision - 1)); // guard bit bounds the rank
+    std::uint8_t rank = 1;
+    while (!(rest & (std::uint64_t(1) << 63)))
+    {
+        rank++;
+        rest <<= 1;
+    }
+    registers[index] = std::max(registers[index], rank);
+}
+
+/**
+ * @brief Combines the sketch of another set of values into this one.
+ *
+ * @param other The sketch to merge in.
+ */
+void HyperLogLog::merge(const HyperLogLog &other)
+{
+    for (std::size_t i = 0; i < registers.size(); i++)
+    {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+/**
+ * @brief Estimates the number of distinct values added, with linear counting for small cardinalities.
+ *
+ * @return double The estimated number of distinct values.
+ */
+double HyperLogLog::estimate() const
+{
+    const double m = static_cast<double>(registers.size());
+    double sum = 0.0;
+    std::size_t zeros = 0;
+    for (std::uint8_t value : registers)
+    {
+        sum += std::ldexp(1.0, -value);
+        zeros += value == 0;
+    }
+
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0)
+    {
+        return m * std::log(m / zeros);
+    }
+    return estimate;
+}
+
+/**
+ * @brief Estimates the proportion of users matching all of the given conditions from a random sample.
+ *
+ * The sample is stratified by data file with proportional allocation, and rows are drawn uniformly
+ * (with replacement) by index, so the cost is O(sampleSize) regardless of the size of the files once
+ * they are cached. The interval is the normal approximation at 95% for a stratified sample; it is
+ * exact when the sample covers the whole population. The generator is seeded identically on every
+ * call, so repeated queries over unchanged data give the same answer.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param where Conditions counted as a success; empty always succeeds.
+ * @param sampleSize Total number of users to sample.
+ * @return ApproximateProportion The estimate and its 95% confidence interval.
+ */
+ApproximateProportion UserStats::EstimateProportion(std::string method, std::vector<Condition> where, std::size_t sampleSize)
+{
+    std::vector<std::shared_ptr<const UserTable>> tables = loadTables(method);
+    std::size_t population = 0;
+    for (const std::shared_ptr<const UserTable> &table : tables)
+    {
+        population += table->size();
+    }
+
+    ApproximateProportion proportion;
+    if (population == 0)
+    {
+        return proportion;
+    }
+
+    std::mt19937_64 generator(0x5eed);
+    double estimate = 0.0, variance = 0.0;
+    for (const std::shared_ptr<const UserTable> &table : tables)
+    {
+        if (table->size() == 0)
+        {
+            continue;
         }
-        else if (user->age >= 60 && user->age <= 79)
+
+        double weight = static_cast<double>(table->size()) / population;
+        std::size_t draws = std::max<std::size_t>(1, static_cast<std::size_t>(std::llround(weight * sampleSize)));
+        std::size_t successes = 0;
+
+        if (draws >= table->size())
         {
-            if (bfp < 13)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 25)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 30)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            // Sampling the whole stratum: count it exactly instead
+            draws = table->size();
+            successes = selectRows(*table, where).size();
+            estimate += weight * successes / draws;
+            continue;
         }
-        else
+
+        std::uniform_int_distribution<std::size_t> pick(0, table->size() - 1);
+        for (std::size_t draw = 0; draw < draws; draw++)
         {
-            std::cout << "The body fat category cannot be determined because you are outside of the permitted age range." << std::endl;
+            std::size_t row = pick(generator);
+            std::uint8_t match = 1;
+            for (const Condition &condition : where)
+            {
+                applyCondition(table.get(), condition, row, row + 1, &match);
+            }
+            successes += match;
         }
+
+        double p = static_cast<double>(successes) / draws;
+        estimate += weight * p;
+        variance += weight * weight * p * (1.0 - p) / draws;
+    }
+
+    double margin = 1.96 * std::sqrt(variance);
+    proportion.estimate = estimate;
+    proportion.low = std::max(0.0, estimate - margin);
+    proportion.high = std::min(1.0, estimate + margin);
+    return proportion;
+}
+
+/**
+ * @brief Computes approximate population statistics from a sample, for exploratory dashboards.
+ *
+ * This is the approximate counterpart of GetFullStats: the healthy, male and female proportions are
+ * estimated by EstimateProportion with 95% confidence intervals, and the number of distinct names
+ * comes from the HyperLogLog sketches built when the data files were loaded. Answering costs
+ * O(sampleSize) instead of a full scan.
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param sampleSize Total number of users to sample.
+ * @return ApproximateStats The estimates; they are also printed to the console.
+ */
+ApproximateStats UserStats::GetApproximateStats(std::string method, std::size_t sampleSize)
+{
+    ApproximateStats stats;
+    HyperLogLog names;
+    for (const std::shared_ptr<const UserTable> &table : loadTables(method))
+    {
+        stats.population += table->size();
+        names.merge(table->distinctNames);
+    }
+    stats.sampleSize = std::min(sampleSize, stats.population);
+    stats.healthy = EstimateProportion(method, { Condition::is(BfpCategory::Normal) }, sampleSize);
+    stats.male = EstimateProportion(method, { Condition::is(Gender::Male) }, sampleSize);
+    stats.female = EstimateProportion(method, { Condition::is(Gender::Female) }, sampleSize);
+    stats.distinctNames = names.estimate();
+
+    auto percent = [](const ApproximateProportion &proportion) {
+        return double_to_string(proportion.estimate * 100, 1) + "% [" + double_to_string(proportion.low * 100, 1) + "%, "
+             + double_to_string(proportion.high * 100, 1) + "%]";
+    };
+    std::cout << "approximate stats (" << method << " method, sample of " << stats.sampleSize << " out of " << stats.population << " users):" << std::endl;
+    std::cout << "male/female percentage: " << percent(stats.male) << " / " << percent(stats.female) << std::endl;
+    std::cout << "healthy: " << percent(stats.healthy) << std::endl;
+    std::cout << "distinct names: " << double_to_string(stats.distinctNames, 0) << std::endl;
+
+    return stats;
+}
+
+/**
+ * @brief Appends the matching rows of a table to the result.
+ *
+ * @param table The table the rows belong to; the RowSet keeps it alive.
+ * @param rows The matching row ids, ascending.
+ */
+void RowSet::add(std::shared_ptr<const UserTable> table, std::vector<std::uint32_t> rows)
+{
+    if (!rows.empty())
+    {
+        parts.push_back({ std::move(table), std::move(rows) });
+    }
+}
+
+/**
+ * @brief Returns the number of rows in the result.
+ *
+ * @return std::size_t The number of rows.
+ */
+std::size_t RowSet::size() const
+{
+    std::size_t count = 0;
+    for (const Segment &segment : parts)
+    {
+        count += segment.rows.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Returns views of the names of the rows, valid while this RowSet exists.
+ *
+ * @return std::vector<std::string_view> The names, in result order.
+ */
+std::vector<std::string_view> RowSet::names() const
+{
+    std::vector<std::string_view> views;
+    views.reserve(size());
+    forEachName([&](std::string_view name) { views.push_back(name); });
+    return views;
+}
+
+/**
+ * @brief Copies the names of the rows, for callers that need to own them.
+ *
+ * @return std::vector<std::string> The names, in result order.
+ */
+std::vector<std::string> RowSet::toStrings() const
+{
+    std::vector<std::string> copies;
+    copies.reserve(size());
+    forEachName([&](std::string_view name) { copies.emplace_back(name); });
+    return copies;
+}
+
+/**
+ * @brief Writes the names of the rows to a stream, one per line, flushing once at the end.
+ *
+ * @param out The stream written to.
+ */
+void RowSet::print(std::ostream &out) const
+{
+    forEachName([&](std::string_view name) { out << name << '\n'; });
+    out.flush();
+}
+
+/**
+ * @brief Selects the users matching all of the given conditions without copying or printing their names.
+ *
+ * Usage example:
+ * RowSet rows = stats.SelectUsers("all", { Condition::is(BfpCategory::Normal) });
+ *
+ * @param method "bmi", "USArmy", or "all" for both data files.
+ * @param where Conditions a user must satisfy; empty selects every user.
+ * @return RowSet The matching rows, in file order.
+ */
+RowSet UserStats::SelectUsers(std::string method, std::vector<Condition> where)
+{
+    RowSet users;
+    for (const std::shared_ptr<const UserTable> &table : loadTables(method))
+    {
+        users.add(table, selectRows(*table, where));
+    }
+    return users;
+}
+
+/**
+ * @brief Appends the profile summary of a user, as displayed by UserInfoManager::displayUser.
+ *
+ * @param userInfo The user rendered.
+ */
+void ProfileRenderer::render(const UserInfo *userInfo)
+{
+    const int precision = 2;
+
+    centered("--- USER PROFILE SUMMARY ---");
+    blank();
+
+    // Personal Details
+    centered("Personal Details:");
+    line.assign("Name: ").append(userInfo->name); endLine();
+    line.assign("Gender: ").append(userInfo->gender); endLine();
+    line.assign("Age (years): "); addInteger(userInfo->age); endLine();
+    line.assign("Height (cm): "); addNumber(userInfo->height, precision); endLine();
+    if (userInfo->gender == "female")
+    {
+        line.assign("Hip (cm): "); addNumber(userInfo->hip, precision); endLine();
     }
 
-    // Return Body Fat Percentage (BFP) and category as a pair
-    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    // Body Measurements
+    blank();
+    centered("Body Measurements:");
+    line.assign("Weight (kg): "); addNumber(userInfo->weight, precision); endLine();
+    line.assign("Waist (cm): "); addNumber(userInfo->waist, precision); endLine();
+    line.assign("Neck (cm): "); addNumber(userInfo->neck, precision); endLine();
+
+    // Lifestyle
+    blank();
+    centered("Lifestyle:");
+    line.assign("Activity Level: ").append(userInfo->lifestyle); endLine();
+
+    // Health Metrics
+    blank();
+    centered("Health Metrics:");
+    line.assign("Body Fat Percentage: "); addNumber(userInfo->bfp.first, precision);
+    line.append("% (").append(userInfo->bfp.second).append(")"); endLine();
+    line.assign("Daily Caloric Intake (calories): "); addNumber(userInfo->daily_calories, precision); endLine();
+
+    // Macronutrient Breakdown
+    blank();
+    centered("Macronutrient Breakdown (grams):");
+    line.assign("Carbs: "); addNumber(userInfo->carbs, precision); line += 'g'; endLine();
+    line.assign("Protein: "); addNumber(userInfo->protein, precision); line += 'g'; endLine();
+    line.assign("Fat: "); addNumber(userInfo->fat, precision); line += 'g'; endLine();
+
+    blank();
 }
 
 /**
- * @brief Calculates the body fat percentage (BFP) for the specified user using the BMI method.
+ * @brief Appends a line of text centered like center(text, kWidth).
  *
- * This function calculates the BFP for the specified user based on their weight and height using the BMI method.
+ * @param text The text of the line.
+ */
+void ProfileRenderer::centered(std::string_view text)
+{
+    line.assign(text);
+    endLine();
+}
+
+/**
+ * @brief Writes the rendered text to a stream in one call, flushes it, and empties the buffer.
  *
- * @param user A pointer to the UserInfo object containing the user's information.
+ * @param out The stream written to.
  */
-void BmiMethod::getBfp(UserInfo *user)
+void ProfileRenderer::flush(std::ostream &out)
 {
-    double bfp;
-    std::string category;
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    buffer.clear();
+}
 
-    bfp = (user->weight*100*100)/(user->height*user->height);
+/**
+ * @brief Appends a number to the current line in fixed notation, like double_to_string().
+ *
+ * @param value The number written.
+ * @param precision Number of decimals.
+ */
+void ProfileRenderer::addNumber(double value, int precision)
+{
+    char digits[350]; // enough for any double in fixed notation
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    line.append(digits, result.ptr);
+}
 
-    if (bfp < 18.5)
+/**
+ * @brief Appends an integer to the current line, like std::to_string().
+ *
+ * @param value The integer written.
+ */
+void ProfileRenderer::addInteger(int value)
+{
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    line.append(digits, result.ptr);
+}
+
+/**
+ * @brief Centers the current line within kWidth columns and moves it to the buffer.
+ */
+void ProfileRenderer::endLine()
+{
+    static const std::string spaces(kWidth, ' ');
+    int diff = kWidth - static_cast<int>(line.size());
+    if (diff > 0)
     {
-        category = "Bmi: Low";
+        buffer.append(spaces, 0, diff / 2);
+        buffer.append(line);
+        buffer.append(spaces, 0, diff - diff / 2);
     }
-    else if (bfp < 25)
+    else
     {
-        category = "Bmi: Normal";
+        buffer.append(line);
     }
-    else if (bfp < 30)
+    buffer += '\n';
+}
+
+/**
+ * @brief Opens the file written, or the temporary file for WriteMode::Rewrite.
+ *
+ * @param path The file produced.
+ * @param mode Whether to append to the file or atomically replace it.
+ */
+BufferedFileWriter::BufferedFileWriter(const std::string &path, WriteMode mode)
+    : target(path), writtenPath(mode == WriteMode::Rewrite ? temporaryPath(path) : path), mode(mode)
+{
+    file.open(writtenPath, mode == WriteMode::Append ? std::ios_base::app | std::ios_base::binary
+                                                     : std::ios_base::trunc | std::ios_base::binary);
+    buffer.reserve(kFlushThreshold + 4096);
+}
+
+/**
+ * @brief Writes out what is buffered in append mode, or discards the temporary file of an uncommitted rewrite.
+ */
+BufferedFileWriter::~BufferedFileWriter()
+{
+    if (committed || !file.is_open())
     {
-        category = "Bmi: High";
+        return;
+    }
+
+    if (mode == WriteMode::Append)
+    {
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
     }
     else
     {
-        category = "Bmi: Very High";
+        file.close();
+        std::error_code ignored;
+        std::filesystem::remove(writtenPath, ignored);
     }
-
-    // Return Body Fat Percentage (BFP) and category as a pair
-    user->bfp = std::make_pair(static_cast<int>(bfp), category);
 }
 
 /**
- * @brief Wrapper method to calculate the daily calorie intake using UserInfoManager.
- *
- * This method acts as a simple wrapper, retrieving the UserInfo object for the specified username
- * and then calling the getDailyCalories method in the UserInfoManager instance, passing the UserInfo object as an argument.
+ * @brief Appends an integer.
  *
- * @param username The username of the user for whom the daily calorie intake is calculated.
+ * @param value The integer written.
  */
-void HealthAssistant::getDailyCalories(std::string username)
+void BufferedFileWriter::appendInteger(long long value)
 {
-    UserInfo* user = userInfoManager.getUserInfo(username);
-    getDailyCalories(user);
+    char digits[24];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+    flushIfFull();
 }
 
 /**
- * @brief Calculates the recommended daily caloric intake based on age, gender, and lifestyle.
- *
- * This function estimates the daily caloric intake needed for an individual based on their age, gender,
- * and lifestyle activity level. The caloric intake recommendations are differentiated by age ranges
- * and activity levels ('sedentary', 'moderate', 'active') for both male and female genders.
- * The calculated intake aims to maintain the individual's current weight, assuming their reported
- * activity level.
- *
- * The activity levels are defined as follows:
- * - 'Sedentary': little or no exercise
- * - 'Moderate': light exercise/sports 1-3 days a week
- * - 'Active': hard exercise/sports 3-5 days a week
+ * @brief Appends a number the way an ostream with default settings does (6 significant digits).
  *
- * Age is considered in three brackets:
- * - 19-30 years
- * - 31-50 years
- * - Over 50 years
+ * @param value The number written.
+ */
+void BufferedFileWriter::appendNumber(double value)
+{
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+    buffer.append(digits, result.ptr);
+    flushIfFull();
+}
+
+/**
+ * @brief Appends a number in fixed notation, like double_to_string().
  *
- * The calorie recommendations are based on general guidelines and may need adjustments for
- * individual metabolism, health conditions, and specific weight goals.
- * @param user Pointer to the UserInfo object for whom the daily calorie intake is calculated.
+ * @param value The number written.
+ * @param precision Number of decimals.
  */
-void HealthAssistant::getDailyCalories(UserInfo *user)
+void BufferedFileWriter::appendFixed(double value, int precision)
 {
-    int calories = 0;
+    char digits[350]; // enough for any double in fixed notation
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    buffer.append(digits, result.ptr);
+    flushIfFull();
+}
 
-    if (user->gender == "male")
+/**
+ * @brief Writes out the remaining data and, in WriteMode::Rewrite, renames the temporary file over the target.
+ *
+ * @throws std::runtime_error if writing or renaming failed; the target is then left untouched by a rewrite.
+ */
+void BufferedFileWriter::commit()
+{
+    writeBuffer();
+    file.close();
+    if (file.fail())
     {
-        if (user->age >= 19 && user->age <= 30)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2400;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2800;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 3000;
-            }
-        }
-        else if (user->age >= 31 && user->age <= 50)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2200;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2600;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 3000;
-            }
-        }
-        else if (user->age > 50)
+        if (mode == WriteMode::Rewrite)
         {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2000;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2400;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2800;
-            }
+            std::error_code ignored;
+            std::filesystem::remove(writtenPath, ignored);
         }
+        throw std::runtime_error("failed writing " + writtenPath);
     }
-    else if (user->gender == "female")
+
+    if (mode == WriteMode::Rewrite)
     {
-        if (user->age >= 19 && user->age <= 30)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2000;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2200;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2400;
-            }
-        }
-        else if (user->age >= 31 && user->age <= 50)
+        std::error_code error;
+        if (!syncToDisk(writtenPath))
         {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 1800;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2000;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2200;
-            }
+            std::filesystem::remove(writtenPath, error);
+            throw std::runtime_error("failed syncing " + writtenPath);
         }
-        else if (user->age > 50)
+        std::filesystem::rename(writtenPath, target, error);
+        if (error)
         {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 1600;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 1800;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2200;
-            }
+            std::filesystem::remove(writtenPath, error);
+            throw std::runtime_error("failed replacing " + target);
         }
-    } else {
-        std::cerr << "This is ackward, your intake calarie wasn't able to be processed" << std::endl;
-        calories = 0;
+        std::filesystem::path directory = std::filesystem::path(target).parent_path();
+        syncToDisk(directory.empty() ? "." : directory.string()); // makes the rename itself durable
     }
-
-    user->daily_calories = calories;
+    committed = true;
 }
 
 /**
- * @brief Retrieves the UserInfo object for a specified username.
+ * @brief Returns a temporary file name next to a path, unique to this process and writer.
  *
- * This method traverses the linked list to find the UserInfo object corresponding to the given username.
- * If the username is not found or the linked list is empty, error messages are displayed, and nullptr is returned.
- *
- * @param username The username of the user for whom the UserInfo object is retrieved.
- * @return Pointer to the UserInfo object if found, otherwise nullptr.
+ * @param path The file produced.
+ * @return std::string "<path>.tmp.<pid>.<n>", in the same directory so it can be renamed over path.
  */
-UserInfo *UserInfoManager::getUserInfo(std::string username)
+std::string BufferedFileWriter::temporaryPath(const std::string &path)
 {
-    if (userInfoList.empty())
-    {
-        std::cerr << "no user in list" << std::endl;
-        return nullptr;
-    }
+    static std::atomic<std::uint64_t> counter{ 0 };
+    return path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+}
 
-    for (UserInfo* user : userInfoList)
+/**
+ * @brief Flushes a file or directory to disk with fsync.
+ *
+ * @param path The file or directory synced.
+ * @return true if it could be opened and synced.
+ */
+bool BufferedFileWriter::syncToDisk(const std::string &path)
+{
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
     {
-        if (user->name == username)
-        {
-            return user;
-        }
+        return false;
     }
-
-    std::cerr << "user not found" << std::endl;
-    return nullptr;
-
+    bool synced = ::fsync(descriptor) == 0;
+    ::close(descriptor);
+    return synced;
 }
 
 /**
- * @brief Wrapper method to calculate the recommended macronutrient distribution for meal preparation using UserInfoManager.
- *
- * This method acts as a simple wrapper, retrieving the UserInfo object for the specified username
- * and then calling the getMealPrep method in the UserInfoManager instance, passing the UserInfo object as an argument.
- *
- * @param username The username of the user for whom the macronutrient distribution is calculated.
+ * @brief Writes the buffered data to the file and empties the buffer.
  */
-void HealthAssistant::getMealPrep(std::string username)
+void BufferedFileWriter::writeBuffer()
 {
-    UserInfo *user = userInfoManager.getUserInfo(username);
-    getMealPrep(user);
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
 }
 
 /**
- * @brief Calculates the required amounts of macronutrients based on a set caloric intake, adhering to standard nutritional guidelines.
- *
- * This function assists in meal planning by breaking down the total daily caloric intake into the recommended proportions of macronutrients:
- * 50% from carbohydrates, 30% from protein, and 20% from fat. It utilizes the caloric values of 4 calories per gram for both carbohydrates
- * and protein, and 9 calories per gram for fat, to calculate the necessary grams of each macronutrient needed to meet the specified caloric intake.
- * The calculated amounts are then returned via reference parameters, allowing for direct integration into meal planning or dietary adjustments.
+ * @brief Returns the process-wide logger.
  *
- * The function supports customization of the caloric intake, making it a versatile tool for dietary planning across a range of nutritional needs
- * and goals. Whether for weight management, athletic performance, or general health, this function provides a foundational step in constructing
- * a balanced diet.
- * @param user Pointer to the UserInfo object for whom the meal prep is calculated.
+ * @return Logger& The shared logger.
  */
-void HealthAssistant::getMealPrep(UserInfo *user)
+Logger &Logger::shared()
 {
-    // Define the percentage of total calories for each macronutrient
-    const double carbs_percentage = 0.50;
-    const double protein_percentage = 0.30;
-    const double fat_percentage = 0.20;
-
-    // Calculate the calories for each macronutrient
-    double carbs_calories = user->daily_calories * carbs_percentage;
-    double protein_calories = user->daily_calories * protein_percentage;
-    double fat_calories = user->daily_calories * fat_percentage;
-
-    // Calculate the grams for each macronutrient
-    user->carbs = carbs_calories / 4.0;
-    user->protein = protein_calories / 4.0;
-    user->fat = fat_calories / 9.0;
+    static Logger logger;
+    return logger;
 }
 
 /**
- * @brief Serializes user data to a CSV file.
- *
- * Usage example:
- * serialize("userData.csv");
- *
- * CSV file example after multiple runs:
- * male,28,72,91,43,,172,sedentary
- * female,23,61,68,36,70,170,moderate
- *
- * @param filename The name (and path, if necessary) of the CSV file to which user data will be appended.
+ * @brief Writes out the pending messages and stops the background thread.
  */
-void UserInfoManager::writeToFile(std::string filename)
+Logger::~Logger()
 {
-    std::ofstream file;
-
-    // Open the file in append mode so that previous data is not overwritten
-    file.open(filename, std::ios_base::app); // using ios_base::app to append to file
-    if (file.is_open())
     {
-        for (UserInfo* user : userInfoList)
-        {
-            file << user->name << ","
-                << user->gender << ","
-                << user->age << ","
-                << user->weight << ","
-                << user->waist << ","
-                << user->neck << ","
-                << (user->gender == "female" ? double_to_string(user->hip, 1) : "") << ","
-                << user->height << ","
-                << user->lifestyle << std::endl; // std::endl to flush the stream
-        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
     }
-    else
+    wake.notify_all();
+    if (writer.joinable())
     {
-        std::cerr << "Error opening file: " << filename << std::endl;
+        writer.join();
     }
-
-    // Close the file stream
-    file.close();
 }
 
 /**
- * @brief Wrapper method to serialize user information to a file using UserInfoManager.
- *
- * This method acts as a simple wrapper, calling the writeToFile method in the UserInfoManager instance associated with the
- * HealthAssistant class, passing the specified filename as an argument.
+ * @brief Redirects the messages written from now on; pending messages are written to the previous stream first.
  *
- * @param filename The name of the file to which user information is serialized.
+ * @param out The stream written to; it must outlive the logger or the next setOutput().
  */
-void HealthAssistant::serialize(std::string filename)
+void Logger::setOutput(std::ostream &out)
 {
-    userInfoManager.writeToFile(filename);
+    flush();
+    std::lock_guard<std::mutex> lock(mutex);
+    output = &out;
 }
 
 /**
- * @brief Reads user data from a specified CSV file and stores it in a vector.
- *
- * This function opens a CSV file with the given filename and reads its contents line by line,
- * parsing each line into a User object. Each line in the CSV file represents a single user's data,
- * structured in the following order: Gender, Age, Weight, Waist, Neck, Hip (optional for females),
- * Height, Lifestyle. The function handles the conditional presence of the hip measurement by checking
- * if the relevant token is empty and assigns a default value of 0.0 if it is absent, ensuring compatibility
- * with male user records where this measurement is not applicable.
- *
- * Assumptions:
- * - The CSV file is located in the same local folder as the program.
- * - The file format is consistent with the expected structure.
- *  - name,gender,age,weight,waist,neck,hip,height,lifestyle
- *  - no empty line except the last line which must be empty.
+ * @brief Queues a message without waiting for it to be written.
  *
- * @param filename The name of the CSV file from which to read user data.
- * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ * @param level Severity of the message; it is discarded if below the current level.
+ * @param message The text, without a trailing newline.
  */
-void UserInfoManager::readFromFile(std::string filename)
+void Logger::log(LogLevel level, std::string message)
 {
-    std::ifstream file(filename);
-    std::string line;
-
-    if (!file.is_open())
+    if (!enabled(level))
     {
-        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
         return;
     }
 
-    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
-    if (ifs.tellg() == 0)
-    {
-        throw std::runtime_error("File is empty: " + filename);
-    }
-
-    while (getline(file, line))
     {
-        std::istringstream iss(line);
-        std::string token;
-        UserInfo *user = new UserInfo;
-
-        getline(iss, user->name, ',');
-        getline(iss, user->gender, ',');
-        getline(iss, token, ',');
-        user->age = std::stoi(token);
-        getline(iss, token, ',');
-        user->weight = std::stod(token);
-        getline(iss, token, ',');
-        user->waist = std::stod(token);
-        getline(iss, token, ',');
-        user->neck = std::stod(token);
-
-        // Check for hip measurement
-        getline(iss, token, ',');
-        user->hip = token.empty() ? 0.0 : std::stod(token); // ok to convert if token is not empty
-
-        getline(iss, token, ',');
-        user->height = std::stod(token);
-        getline(iss, user->lifestyle);
-
-        userInfoList.push_back(user);
-        std::cout << line << std::endl;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == ring.size())
+        {
+            dropped++;
+            return;
+        }
+        ring[(head + count) % ring.size()] = { level, std::move(message) };
+        count++;
+        if (!writer.joinable())
+        {
+            writer = std::thread(&Logger::drain, this);
+        }
     }
-
-    file.close();
+    wake.notify_one();
 }
 
 /**
- * @brief Wrapper method to read user information from a file using UserInfoManager.
- *
- * This method acts as a simple wrapper, calling the readFromFile method in the UserInfoManager instance associated with the
- * HealthAssistant class, passing the specified filename as an argument.
- *
- * @param filename The name of the file from which user information is read.
+ * @brief Blocks until every message queued so far has been written and the stream flushed.
  */
-void HealthAssistant::readFromFile(std::string filename)
+void Logger::flush()
 {
-    userInfoManager.readFromFile(filename);
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [&] { return (count == 0 && dropped == 0 && !writing) || !writer.joinable(); });
 }
 
 /**
- * @brief Helper function to remove trailing whitespaces.
- *
- * @param input String input to convert.
- * @return std::string
+ * @brief Body of the background thread: writes batches of messages until the logger is destroyed.
  */
-std::string trim(const std::string &str)
+void Logger::drain()
 {
-    auto start = str.begin();
-    auto end = str.end();
-
-    while (start != str.end() && std::isspace(*start))
+    static const char *const labels[] = { "debug", "info", "warn", "error" };
+    std::vector<std::pair<LogLevel, std::string>> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
     {
-        start++;
-    }
+        wake.wait(lock, [&] { return count > 0 || dropped > 0 || stopping; });
+        if (count == 0 && dropped == 0)
+        {
+            return;
+        }
 
-    do
-    {
-        end--;
-    } while (std::distance(start, end) > 0 && std::isspace(*end));
+        for (; count > 0; count--, head = (head + 1) % ring.size())
+        {
+            batch.push_back(std::move(ring[head]));
+        }
+        std::size_t lost = dropped;
+        dropped = 0;
+        std::ostream &out = *output;
+        writing = true;
+        lock.unlock();
+
+        std::string text;
+        for (const std::pair<LogLevel, std::string> &entry : batch)
+        {
+            text.append("[").append(labels[static_cast<int>(entry.first)]).append("] ").append(entry.second).append("\n");
+        }
+        if (lost > 0)
+        {
+            text.append("[warn] ").append(std::to_string(lost)).append(" log messages dropped\n");
+        }
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        out.flush();
+        batch.clear();
 
-    return std::string(start, end + 1);
+        lock.lock();
+        writing = false;
+        drained.notify_all();
+    }
 }
 
 /**
- * @brief Helper function to convert a string to lowercase.
+ * @brief Appends a number with the fewest digits that read back as exactly the same double.
  *
- * @param input String input to convert.
- * @return std::string
+ * @param value The number written.
  */
-std::string toLower(const std::string &input)
+void BufferedFileWriter::appendExact(double value)
 {
-    std::string output = input;
-
-    std::transform(output.begin(), output.end(), output.begin(), [](unsigned char c)
-                   { return std::tolower(c); });
-    return output;
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+    flushIfFull();
 }
 
 /**
- * @brief Prompts for and sets the user's gender after validation.
+ * @brief Appends a JSON string literal, escaping quotes, backslashes and control characters.
  *
- * Continuously prompts the user to input their gender until "male" or "female" is provided.
- * Converts the input to lowercase for validation and assigns it to the User struct field upon success.
- * @param user Pointer to the UserInfo object for which the gender information is obtained and set.
+ * @param text The UTF-8 text written.
  */
-void UserInfoManager::getGender(UserInfo *user)
+void BufferedFileWriter::appendJsonString(std::string_view text)
 {
-    std::string input;
-
-    while (true)
+    static const char hex[] = "0123456789abcdef";
+    buffer += '"';
+    for (char c : text)
     {
-        std::cout << "Please specify your gender as either male or female: ";
-        std::cin >> input;
-        input = toLower(trim(input));
-        bufferClear();
-
-        if (input == "male" || input == "female")
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\')
         {
-            user->gender = input;
-            break;
+            buffer += '\\';
+            buffer += c;
+        }
+        else if (c == '\n')
+        {
+            buffer.append("\\n");
+        }
+        else if (c == '\t')
+        {
+            buffer.append("\\t");
+        }
+        else if (byte < 0x20)
+        {
+            buffer.append("\\u00");
+            buffer += hex[byte >> 4];
+            buffer += hex[byte & 0xf];
         }
         else
         {
-            std::cerr << "The gender entered is not yet supported. Please specify as either \"male\" or \"female\"." << std::endl;
+            buffer += c;
         }
     }
+    buffer += '"';
+    flushIfFull();
 }
 
 /**
- * @brief Prompts the user for their hip measurement in centimeters and assigns it to the user object.
- *
- * This function is only applicable if the user's gender is set to "female". It continuously prompts the user
- * to enter their hip measurement until a valid numeric input is provided. The function checks for valid decimal
- * or whole number input. If the input is not a valid number, it displays an error message and prompts the user again.
- * Upon receiving a valid input, the measurement is assigned to the User struct field.
+ * @brief Opens a JSON Lines file for reading.
  *
- * @param user Pointer to the UserInfo object for which the Hip information is obtained and set.
+ * @param path The file read.
  */
-void UserInfoManager::getHipMeasurement(UserInfo *user)
+JsonLinesReader::JsonLinesReader(const std::string &path)
+    : file(path, std::ios_base::binary), buffer(kChunkSize)
 {
-    double input;
+}
 
-    if (user->gender != "female")
+/**
+ * @brief Reads the next profile, skipping blank lines.
+ *
+ * @param user Receives the profile; fields missing from the line are reset to their defaults.
+ * @return true if a profile was read, false at the end of the file.
+ * @throws std::runtime_error if the line is not a valid JSON object.
+ */
+bool JsonLinesReader::next(UserInfo &user)
+{
+    std::string_view line;
+    while (nextLine(line))
     {
-        return;
+        if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+        {
+            parse(line, user);
+            return true;
+        }
     }
+    return false;
+}
+
+/**
+ * @brief Returns a view of the next line in the buffer, refilling it from the file as needed.
+ *
+ * @param line Receives the line without its newline; valid until the next call.
+ * @return true if a line was found, false at the end of the file.
+ */
+bool JsonLinesReader::nextLine(std::string_view &line)
+{
     while (true)
     {
-        std::cout << "Enter your hip measurement in centimeters: ";
+        const char *newline = static_cast<const char*>(std::memchr(buffer.data() + begin, '\n', end - begin));
+        if (newline)
+        {
+            line = std::string_view(buffer.data() + begin, newline - (buffer.data() + begin));
+            begin = newline - buffer.data() + 1;
+            lines++;
+            return true;
+        }
 
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
-            user->hip = input;
-            // std::cout << input << std::endl;
-            break;
+        if (!file)
+        {
+            if (begin == end)
+            {
+                return false;
+            }
+            line = std::string_view(buffer.data() + begin, end - begin); // last line without a newline
+            begin = end;
+            lines++;
+            return true;
         }
-        else
+
+        // Keep the partial line, growing the buffer only for lines longer than a chunk
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        if (end == buffer.size())
         {
-            std::cerr << "Invalid input for hip measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+            buffer.resize(buffer.size() * 2);
         }
-        bufferClear();
+        file.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+        end += static_cast<std::size_t>(file.gcount());
     }
-    bufferClear();
 }
 
 /**
- * @brief Prompts the user for their age and validates the input.
+ * @brief Parses one line holding a JSON object into a profile.
  *
- * Continuously prompts the user to enter their age until a valid integer is provided.
- * If the input is not a valid integer, it displays an error message and prompts the user again.
- * Upon receiving a valid input, the age is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Age information is obtained and set.
+ * @param line The line parsed.
+ * @param user Receives the profile.
+ * @throws std::runtime_error if the line is not a valid JSON object.
  */
-void UserInfoManager::getAge(UserInfo *user)
+void JsonLinesReader::parse(std::string_view line, UserInfo &user) const
 {
-    double input;
-
-    while (true)
-    {
-        std::cout << "Enter your age: ";
-
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
+    const char *p = line.data();
+    const char *const last = line.data() + line.size();
+    auto fail = [&](const char *what) {
+        parseError(line, p, what);
+    };
+    auto skipSpace = [&] {
+        while (p < last && (*p == ' ' || *p == '\t' || *p == '\r'))
+        {
+            p++;
+        }
+    };
+    auto expect = [&](char c) {
+        skipSpace();
+        if (p == last || *p != c)
+        {
+            parseError(line, p, "expected", c);
+        }
+        p++;
+    };
+    auto appendUtf8 = [](std::string &out, unsigned code) {
+        if (code < 0x80)
+        {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000)
+        {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    };
+    auto hex4 = [&]() {
+        unsigned code = 0;
+        if (last - p < 4)
+        {
+            fail("truncated \\u escape");
+        }
+        std::from_chars_result result = std::from_chars(p, p + 4, code, 16);
+        if (result.ptr != p + 4)
+        {
+            fail("invalid \\u escape");
+        }
+        p += 4;
+        return code;
+    };
+    // Reads a string literal; unescaped strings are returned as a view, escaped ones are decoded into scratch
+    std::string scratch;
+    auto readString = [&]() -> std::string_view {
+        expect('"');
+        const char *start = p;
+        while (p < last && *p != '"' && *p != '\\')
+        {
+            p++;
+        }
+        if (p < last && *p == '"')
+        {
+            return std::string_view(start, p++ - start);
+        }
 
-            // age limits BMI
-            if (input < 20)
+        scratch.assign(start, p);
+        while (p < last && *p != '"')
+        {
+            if (*p != '\\')
             {
-                std::cerr << "You need to be older to use this tool" << std::endl;
+                scratch += *p++;
+                continue;
             }
-            else if (input > 79)
+            if (++p == last)
             {
-                std::cerr << "You need to be younger to use this tool" << std::endl;
-            }
-            else{
-                user->age = input;
-                // std::cout << user.g_age << std::endl;
                 break;
             }
+            char escape = *p++;
+            switch (escape)
+            {
+                case '"': case '\\': case '/': scratch += escape; break;
+                case 'b': scratch += '\b'; break;
+                case 'f': scratch += '\f'; break;
+                case 'n': scratch += '\n'; break;
+                case 'r': scratch += '\r'; break;
+                case 't': scratch += '\t'; break;
+                case 'u':
+                {
+                    unsigned code = hex4();
+                    if (code >= 0xdc00 && code < 0xe000)
+                    {
+                        fail("unpaired low surrogate");
+                    }
+                    if (code >= 0xd800 && code < 0xdc00)
+                    {
+                        if (last - p < 6 || p[0] != '\\' || p[1] != 'u')
+                        {
+                            fail("unpaired high surrogate");
+                        }
+                        p += 2;
+                        unsigned low = hex4();
+                        if (low < 0xdc00 || low >= 0xe000)
+                        {
+                            fail("invalid low surrogate");
+                        }
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(scratch, code);
+                    break;
+                }
+                default: p--; fail("invalid escape");
+            }
         }
-        else
+        if (p == last)
         {
-            std::cerr << "Invalid input for age. Please specify your age as a whole number." << std::endl;
+            fail("unterminated string");
         }
-        bufferClear();
+        p++;
+        return scratch;
+    };
+    // Reads a number or null (returned as nullopt)
+    auto readNumber = [&]() -> std::optional<double> {
+        skipSpace();
+        if (last - p >= 4 && std::string_view(p, 4) == "null")
+        {
+            p += 4;
+            return std::nullopt;
+        }
+        // Integers, the common case for age, bfp and calories, skip the slower floating-point conversion
+        long long integer = 0;
+        std::from_chars_result result = std::from_chars(p, last, integer);
+        if (result.ec == std::errc() && (result.ptr == last || (*result.ptr != '.' && *result.ptr != 'e' && *result.ptr != 'E')))
+        {
+            p = result.ptr;
+            return static_cast<double>(integer);
+        }
+
+        double value = 0.0;
+        result = std::from_chars(p, last, value);
+        if (result.ec != std::errc())
+        {
+            fail("expected a number");
+        }
+        if (!std::isfinite(value))
+        {
+            fail("number out of range");
+        }
+        p = result.ptr;
+        return value;
+    };
+    // Skips a value of a member that is not part of a profile, including nested objects and arrays
+    auto skipValue = [&]() {
+        skipSpace();
+        if (p == last || *p == ',' || *p == '}' || *p == ']')
+        {
+            fail("expected a value");
+        }
+        int depth = 0;
+        do
+        {
+            if (p == last)
+            {
+                fail("unterminated value");
+            }
+            if (*p == '"')
+            {
+                readString();
+                continue;
+            }
+            if (*p == '{' || *p == '[')
+            {
+                depth++;
+            }
+            else if (*p == '}' || *p == ']')
+            {
+                if (depth == 0)
+                {
+                    return;
+                }
+                depth--;
+            }
+            else if (*p == ',' && depth == 0)
+            {
+                return;
+            }
+            p++;
+        } while (depth > 0 || (p < last && *p != ',' && *p != '}'));
+    };
+
+    static const std::string_view keys[] = { "name", "gender", "age", "weight", "waist", "neck", "hip", "height",
+                                             "lifestyle", "bfp", "category", "daily_calories", "carbs", "protein", "fat", "method" };
+    user.age = 0;
+    user.weight = user.waist = user.neck = user.height = user.hip = 0.0;
+    user.carbs = user.protein = user.fat = 0.0;
+    user.bfp.first = 0;
+    user.bfp.second.clear();
+    user.bfpType.reset();
+    user.daily_calories = 0;
+    user.name.clear();
+    user.gender.clear();
+    user.lifestyle.clear();
+    bool hasMethod = false;
+
+    expect('{');
+    skipSpace();
+    if (p < last && *p == '}')
+    {
+        p++;
     }
-    bufferClear();
-}
+    else
+    {
+        while (true)
+        {
+            std::string_view key = readString(); // a view into line or scratch, compared before the value is read
+            expect(':');
+            skipSpace();
+
+            auto text = [&](std::string &field) {
+                if (last - p >= 4 && std::string_view(p, 4) == "null")
+                {
+                    p += 4;
+                    return;
+                }
+                field.assign(readString());
+            };
+            auto number = [&](auto &field) {
+                using Field = std::remove_reference_t<decltype(field)>;
+                const char *start = p;
+                if (std::optional<double> value = readNumber())
+                {
+                    if constexpr (std::is_integral_v<Field>)
+                    {
+                        // Converting a double outside of the int range is undefined, so such values are rejected
+                        if (!(*value > static_cast<double>(std::numeric_limits<Field>::min()) - 1.0
+                              && *value < static_cast<double>(std::numeric_limits<Field>::max()) + 1.0))
+                        {
+                            p = start;
+                            fail("number out of range");
+                        }
+                    }
+                    field = static_cast<Field>(*value);
+                }
+            };
+
+            switch (std::find(std::begin(keys), std::end(keys), key) - std::begin(keys))
+            {
+                case 0: text(user.name); break;
+                case 1: text(user.gender); break;
+                case 2: number(user.age); break;
+                case 3: number(user.weight); break;
+                case 4: number(user.waist); break;
+                case 5: number(user.neck); break;
+                case 6: number(user.hip); break;
+                case 7: number(user.height); break;
+                case 8: text(user.lifestyle); break;
+                case 9: number(user.bfp.first); break;
+                case 10: text(user.bfp.second); break;
+                case 11: number(user.daily_calories); break;
+                case 12: number(user.carbs); break;
+                case 13: number(user.protein); break;
+                case 14: number(user.fat); break;
+                case 15:
+                    hasMethod = true;
+                    if (last - p >= 4 && std::string_view(p, 4) == "null")
+                    {
+                        p += 4;
+                    }
+                    else
+                    {
+                        std::string_view method = readString();
+                        if (method != "bmi" && method != "usnavy")
+                        {
+                            fail("unknown method");
+                        }
+                        user.bfpType = method == "bmi" ? BfpType::BmiMethod : BfpType::USNavyMethod;
+                    }
+                    break;
+                default: skipValue(); break;
+            }
 
-/**
- * @brief Prompts the user for their body weight and validates the input.
- *
- * Continuously prompts the user to enter their body weight in kilograms until a valid number is provided.
- * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
- * prompts the user again. Upon receiving a valid input, the weight is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Weight information is obtained and set.
- */
-void UserInfoManager::getBodyWeightMeasurement(UserInfo *user)
-{
-    double input;
+            skipSpace();
+            if (p < last && *p == ',')
+            {
+                p++;
+                continue;
+            }
+            expect('}');
+            break;
+        }
+    }
 
-    while (true)
+    skipSpace();
+    if (p != last)
     {
-        std::cout << "Enter your body weight in kilograms: ";
+        fail("unexpected text after the object");
+    }
 
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
-            user->weight = input;
-            // std::cout << input << std::endl;
-            break;
-        }
-        else
-        {
-            std::cerr << "Invalid input for body weight. Please specify your measurement as a whole number or a decimal." << std::endl;
-        }
-        bufferClear();
+    if (!hasMethod && !user.bfp.second.empty())
+    {
+        user.bfpType = user.bfp.second.rfind("Bmi: ", 0) == 0 ? BfpType::BmiMethod : BfpType::USNavyMethod;
     }
-    bufferClear();
 }
 
 /**
- * @brief Prompts the user for their waist measurement and validates the input.
+ * @brief Throws the error for an invalid line; kept out of line so the parsing loops stay small.
  *
- * Continuously prompts the user to enter their waist measurement in centimeters until a valid number is provided.
- * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
- * prompts the user again. Upon receiving a valid input, the waist measurement is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Waist information is obtained and set.
+ * @param line The line being parsed.
+ * @param position Where parsing failed.
+ * @param what Description of the problem.
+ * @param expected Character that was expected at position, or 0.
+ * @throws std::runtime_error always.
  */
-void UserInfoManager::getWaistMeasurement(UserInfo *user)
+void JsonLinesReader::parseError(std::string_view line, const char *position, const char *what, char expected) const
 {
-    double input;
-
-    while (true)
+    std::string message = "JSON line " + std::to_string(lines) + ": " + what;
+    if (expected)
     {
-        std::cout << "Input your waist measurement in centimeters: ";
-
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
-            user->waist = input;
-            // std::cout << input << std::endl;
-            break;
-        }
-        else
-        {
-            std::cerr << "Invalid input for waist measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
-        }
-        bufferClear();
+        message += std::string(" '") + expected + "'";
     }
-    bufferClear();
+    throw std::runtime_error(message + " at column " + std::to_string(position - line.data() + 1));
 }
 
 /**
- * @brief Prompts the user for their neck measurement and validates the input.
+ * @brief Imports user profiles, including computed results, from a JSON Lines file.
  *
- * Continuously prompts the user to enter their neck measurement in centimeters until a valid number is provided.
- * The input can be a whole number or a decimal. If the input is not valid, it displays an error message and
- * prompts the user again. Upon receiving a valid input, the neck measurement is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Neck information is obtained and set.
+ * Usage example:
+ * readJsonLines("users.jsonl");
+ *
+ * Each line holds one object such as
+ * {"name":"john","gender":"male","age":28,"weight":72,"waist":91,"neck":43,"hip":0,"height":172,
+ *  "lifestyle":"sedentary","bfp":20,"method":"usnavy","category":"USNavy: Normal","daily_calories":2400,
+ *  "carbs":1200,"protein":600,"fat":266.667}
+ * The file is streamed, so only the profiles themselves are kept in memory. Files written before
+ * "method" existed get the method from the prefix of the category.
+ *
+ * @param filename The name of the JSON Lines file to read.
+ * @throws std::runtime_error if the file cannot be opened or a line is not a valid JSON object.
  */
-void UserInfoManager::getNeckMeasurement(UserInfo *user)
+void UserInfoManager::readJsonLines(std::string filename)
 {
-    double input;
+    JsonLinesReader reader(filename);
+    if (!reader.isOpen())
+    {
+        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
+    }
 
-    while (true)
+    std::vector<UserInfo*> batch;
+    std::unique_ptr<UserInfo> user(new UserInfo);
+    try
     {
-        std::cout << "Provide your neck measurement in centimeters: ";
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
-            user->neck = input;
-            // std::cout << input << std::endl;
-            break;
-        }
-        else
+        while (reader.next(*user))
         {
-            std::cerr << "Invalid input for neck measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
+            batch.push_back(user.release());
+            user.reset(new UserInfo);
+            if (batch.size() == kSegmentSize)
+            {
+                addUsers(batch);
+                batch.clear();
+            }
         }
-        bufferClear();
     }
-    bufferClear();
+    catch (...)
+    {
+        addUsers(batch); // keep the users read before the error, as when they were added one by one
+        throw;
+    }
+    addUsers(batch);
 }
 
 /**
- * @brief Prompts the user for their height and validates the input.
+ * @brief Exports user profiles, including computed results, to a JSON Lines file.
  *
- * This function continuously prompts the user to enter their height in centimeters until a valid numeric input is provided.
- * The input can be either a whole number or a decimal. If the input is not a valid number, the function displays an error message
- * and prompts the user again. Upon receiving a valid input, the height is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Height information is obtained and set.
+ * Numbers are written with the fewest digits that read back exactly, so an export followed by
+ * readJsonLines reproduces every field; non-finite numbers are written as null.
+ *
+ * @param filename The name of the JSON Lines file to write.
+ * @param mode WriteMode::Rewrite atomically replaces the file, WriteMode::Append adds to it.
  */
-void UserInfoManager::getHeightMeasurement(UserInfo *user)
+void UserInfoManager::writeJsonLines(std::string filename, WriteMode mode)
 {
-    double input;
-
-    while (true)
-    {
-        std::cout << "Provide your height measurement in centimeters: ";
-        if (std::cin >> input)
-        { // if the input is successfully read as a number
-            user->height = input;
-            // std::cout << input << std::endl;
-            break;
-        }
-        else
-        {
-            std::cerr << "Invalid input for height measurement. Please specify your measurement as a whole number or a decimal." << std::endl;
-        }
-        bufferClear();
-    }
-    bufferClear();
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    writeUsers(filename, mode, ExportFormat::JsonLines, 0, userInfoList.size());
 }
 
 /**
- * @brief Prompts the user for their lifestyle choice and validates the input.
+ * @brief Appends a user as one JSON Lines object, including computed results.
  *
- * Continuously prompts the user to specify their lifestyle as either "sedentary", "moderate", or "active".
- * The input is case-insensitive. If the input does not match any of the expected lifestyle choices, it displays an error message and
- * prompts the user again. Upon receiving a valid input, the lifestyle choice is assigned to the User struct field.
- * @param user Pointer to the UserInfo object for which the Lifestyle information is obtained and set.
+ * @param file The writer appended to.
+ * @param user The user written.
  */
-void UserInfoManager::getLifestyle(UserInfo *user)
+void UserInfoManager::appendJsonRow(BufferedFileWriter &file, const UserInfo *user)
 {
-    std::string input;
-
-    while (true)
-    {
-        std::cout << "Provide information about your current lifestyle: sedentary, moderate (moderately active) or active: ";
-        std::cin >> input;
-        input = toLower(trim(input));
-        bufferClear();
-
-        if (input == "moderately")
-        {
-            input = "moderate";
-        }
-
-        if (input == "sedentary" || input == "moderate" || input == "active")
+    auto member = [&](std::string_view key, double value) {
+        file.append(key);
+        if (std::isfinite(value))
         {
-            user->lifestyle = input;
-            break;
+            file.appendExact(value);
         }
         else
         {
-            std::cerr << "The lifestyle you entered is not yet supported. Please specify as either \"sedentary\", \"moderate\", or \"active\"." << std::endl;
+            file.append("null");
         }
-    }
+    };
+
+    file.append("{\"name\":");
+    file.appendJsonString(user->name);
+    file.append(",\"gender\":");
+    file.appendJsonString(user->gender);
+    file.append(",\"age\":");
+    file.appendInteger(user->age);
+    member(",\"weight\":", user->weight);
+    member(",\"waist\":", user->waist);
+    member(",\"neck\":", user->neck);
+    member(",\"hip\":", user->hip);
+    member(",\"height\":", user->height);
+    file.append(",\"lifestyle\":");
+    file.appendJsonString(user->lifestyle);
+    file.append(",\"bfp\":");
+    file.appendInteger(user->bfp.first);
+    file.append(",\"method\":");
+    file.append(!user->bfpType ? "null" : *user->bfpType == BfpType::BmiMethod ? "\"bmi\"" : "\"usnavy\"");
+    file.append(",\"category\":");
+    file.appendJsonString(user->bfp.second);
+    file.append(",\"daily_calories\":");
+    file.appendInteger(user->daily_calories);
+    member(",\"carbs\":", user->carbs);
+    member(",\"protein\":", user->protein);
+    member(",\"fat\":", user->fat);
+    file.append("}\n");
 }
 
 /**
- * @brief Gets and sets the name information for a user.
+ * @brief Returns a page of users starting at a cursor.
  *
- * This method prompts the user to enter their name and sets the name attribute in the UserInfo object accordingly.
+ * Every user gets an id when added, larger than any id given before, and a cursor names the id
+ * the page starts at. Pages therefore stay consistent while users are added or deleted between
+ * requests: no remaining user is skipped or repeated, and users added meanwhile appear on the last
+ * page. Finding the start is a binary search, so a page costs O(log n + limit).
  *
- * @param user Pointer to the UserInfo object for which the name information is obtained and set.
+ * Usage example:
+ * std::string cursor;
+ * do { UserPage page = manager.getPage(cursor, 100); ...; cursor = page.nextCursor; } while (!cursor.empty());
+ *
+ * @param cursor Cursor returned with the previous page, or empty for the first page.
+ * @param limit Maximum number of users returned.
+ * @return UserPage The users and the cursor of the next page.
+ * @throws std::runtime_error if the cursor is not one returned by getPage.
+ * @throws std::invalid_argument if limit is 0.
  */
-void UserInfoManager::getName(UserInfo *user)
+UserPage UserInfoManager::getPage(const std::string &cursor, std::size_t limit) const
 {
-    std::string input;
-    std::cout << "What is your name: ";
-    std::cin >> input;
-    bufferClear();
-
-    user->name = toLower(trim(input));
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return pageAt(cursorIndex(cursor), limit);
 }
 
 /**
- * @brief Mass loads user information from a file and computes additional attributes.
+ * @brief Returns a page of users starting at a position in the list.
  *
- * This method reads user information from a CSV file, creates UserInfo objects, and adds them to the linked list.
- * It then calculates the Body Fat Percentage (BFP), daily calorie intake, and recommended macronutrient distribution for each user.
+ * Offsets shift when users are deleted; use the cursor overload to walk the whole list.
  *
- * @param filename The name of the file from which user information is mass-loaded.
- * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ * @param offset Index of the first user returned.
+ * @param limit Maximum number of users returned.
+ * @return UserPage The users and the cursor of the next page.
+ * @throws std::invalid_argument if limit is 0.
  */
-void HealthAssistant::massLoadAndCompute(std::string filename)
+UserPage UserInfoManager::getPage(std::size_t offset, std::size_t limit) const
 {
-    std::ifstream file(filename);
-    std::string line;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return pageAt(std::min(offset, userInfoList.size()), limit);
+}
 
-    if (!file.is_open())
+/**
+ * @brief Displays one page of user profiles, rendered and written in a single call.
+ *
+ * @param cursor Cursor returned by the previous page, or empty for the first page.
+ * @param limit Maximum number of users displayed.
+ * @return std::string Cursor of the next page, empty after the last page.
+ * @throws std::runtime_error if the cursor is not valid.
+ * @throws std::invalid_argument if limit is 0.
+ */
+std::string UserInfoManager::displayPage(const std::string &cursor, std::size_t limit)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    UserPage page = pageAt(cursorIndex(cursor), limit);
+    ProfileRenderer renderer;
+    for (const UserInfo &user : page.users)
     {
-        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
-        return;
+        renderer.render(&user);
     }
+    renderer.flush(std::cout);
+    return page.nextCursor;
+}
 
-    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
-    if (ifs.tellg() == 0)
+/**
+ * @brief Writes one page of users to a file.
+ *
+ * Usage example:
+ * std::string cursor;
+ * do { cursor = manager.exportPage("users.jsonl", cursor, 10000, ExportFormat::JsonLines); } while (!cursor.empty());
+ *
+ * @param filename The file written.
+ * @param cursor Cursor returned by the previous page, or empty for the first page.
+ * @param limit Maximum number of users written.
+ * @param format Row format of the file.
+ * @param mode Whether to append to the file or atomically replace it.
+ * @return std::string Cursor of the next page, empty after the last page.
+ * @throws std::runtime_error if the cursor is not valid.
+ * @throws std::invalid_argument if limit is 0.
+ */
+std::string UserInfoManager::exportPage(std::string filename, const std::string &cursor, std::size_t limit,
+                                        ExportFormat format, WriteMode mode)
+{
+    if (limit == 0)
     {
-        throw std::runtime_error("File is empty: " + filename);
+        throw std::invalid_argument("Page limit must be at least 1");
     }
 
-    while (getline(file, line))
-    {
-        std::istringstream iss(line);
-        std::string token;
-        UserInfo *user = new UserInfo;
-
-        getline(iss, user->name, ',');
-        getline(iss, user->gender, ',');
-        getline(iss, token, ',');
-        user->age = std::stoi(token);
-        getline(iss, token, ',');
-        user->weight = std::stod(token);
-        getline(iss, token, ',');
-        user->waist = std::stod(token);
-        getline(iss, token, ',');
-        user->neck = std::stod(token);
-
-        // Check for hip measurement
-        getline(iss, token, ',');
-        user->hip = token.empty() ? 0.0 : std::stod(token); // ok to convert if token is not empty
-
-        getline(iss, token, ',');
-        user->height = std::stod(token);
-        getline(iss, user->lifestyle);
-
-        getBfp(user);
-        getDailyCalories(user);
-        getMealPrep(user);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::size_t begin = cursorIndex(cursor);
+    std::size_t end = begin + std::min(limit, userInfoList.size() - begin);
+    writeUsers(filename, mode, format, begin, end);
+    return end < userIds.size() ? std::to_string(userIds[end]) : std::string();
+}
 
-        userInfoManager.addUserInfo(user);
+/**
+ * @brief Translates a cursor to the index of the first user with an id at least as large.
+ *
+ * @param cursor The cursor, or empty for the start of the list.
+ * @return std::size_t The index, userInfoList.size() if every user comes before the cursor.
+ * @throws std::runtime_error if the cursor is not valid.
+ */
+std::size_t UserInfoManager::cursorIndex(const std::string &cursor) const
+{
+    if (cursor.empty())
+    {
+        return 0;
     }
 
-    file.close();
+    std::uint64_t id = 0;
+    std::from_chars_result result = std::from_chars(cursor.data(), cursor.data() + cursor.size(), id);
+    if (result.ec != std::errc() || result.ptr != cursor.data() + cursor.size())
+    {
+        throw std::runtime_error("Invalid cursor: " + cursor);
+    }
+    return std::lower_bound(userIds.begin(), userIds.end(), id) - userIds.begin();
 }
 
 /**
- * @brief Adds user information to the manager.
+ * @brief Builds the page of at most limit users starting at an index.
  *
- * This function adds the provided user information to the list of user information managed by the UserInfoManager.
+ * A page of 0 users would return the cursor it started at, so paging loops would never end.
  *
- * @param userInfo A pointer to the UserInfo object containing the user's information to be added.
+ * @param index Index of the first user.
+ * @param limit Maximum number of users.
+ * @return UserPage The page.
+ * @throws std::invalid_argument if limit is 0.
  */
-void UserInfoManager::addUserInfo(UserInfo *userInfo){
-    userInfoList.push_back(userInfo);
+UserPage UserInfoManager::pageAt(std::size_t index, std::size_t limit) const
+{
+    if (limit == 0)
+    {
+        throw std::invalid_argument("Page limit must be at least 1");
+    }
+
+    UserPage page;
+    std::size_t end = index + std::min(limit, userInfoList.size() - index);
+    page.users.reserve(end - index);
+    for (std::size_t i = index; i < end; i++)
+    {
+        page.users.push_back(*userInfoList[i]);
+    }
+    if (end < userIds.size())
+    {
+        page.nextCursor = std::to_string(userIds[end]);
+    }
+    return page;
 }
 
 /**
- * @brief Clears the input buffer.
+ * @brief Applies a computation to every user, keeping the live statistics up to date.
  *
- * This function clears the input buffer of the standard input stream (std::cin).
- * It is useful for discarding any remaining characters in the input buffer, such as after
- * an invalid input or when switching between different types of input.
+ * @param compute Function updating the computed fields of a user.
  */
-void bufferClear()
+void UserInfoManager::recomputeAll(const std::function<void(UserInfo*)> &compute)
 {
-    std::cin.clear();
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (std::size_t i = 0; i < userInfoList.size(); i++)
+    {
+        recomputeUser(userInfoList[i], compute);
+        publishedUsers[i] = std::make_shared<const UserInfo>(*userInfoList[i]);
+    }
+    dirtyFrom = 0;
+    publish();
 }
 
 /**
- * @brief Loads user information from a file and computes body fat percentage (BFP) for each user.
+ * @brief Renders the profile summary of every user into report files in a directory.
  *
- * This function reads user information from the specified file and computes the body fat percentage
- * (BFP) for each user using the specified method (BMI method or US Navy method). It returns a shared
- * pointer to a vector containing pointers to UserInfo objects, representing the loaded user information.
+ * Report files are the work items of the job: file i holds the users from index i * usersPerFile,
+ * and is named "<index>-<name>.txt" with one user per file or "reports-<i>.txt" when sharded.
+ * Files are rendered and written in parallel on the shared ThreadPool, each through a
+ * BufferedFileWriter in WriteMode::Rewrite, so a report file exists only once it is complete.
+ * Throughput is printed when the job ends.
  *
- * @param filename The name of the file containing user information.
- * @param bfpType The type of method used to compute body fat percentage (BMI method or US Navy method).
- * @return A shared pointer to a vector containing pointers to UserInfo objects representing the loaded user information.
- * @throws std::runtime_error if the file cannot be opened, or if the file is empty.
+ * The directory holds a manifest, report-job.manifest, identifying the job by its user count, first
+ * and last user id, a digest of the names in list order, usersPerFile and kFormulaVersion:
+ *
+ * # report-job users=2000 first=1 last=2000 names=5c1f0e2d9a7b3c41 per-file=1 formula=1
+ *
+ * Resuming an interrupted job is running it again over the same user list: when the manifest
+ * matches, report files already present are skipped. Otherwise the report files of the earlier job
+ * are deleted and every file is written again. Temporary files left by a crash are removed either
+ * way, so only one job may run in a directory at a time.
+ *
+ * @param options Output directory, sharding and thread count.
+ * @return ReportJobResult The files written and skipped, and the throughput.
+ * @throws std::runtime_error if the directory cannot be created or a report file cannot be written;
+ *         files completed before the error are kept for a resume.
  */
-std::shared_ptr<std::vector<UserInfo*>> UserStats::massLoadAndCompute(std::string filename, BfpType bfpType)
+ReportJobResult UserInfoManager::writeReports(const ReportJobOptions &options)
 {
-    std::ifstream file(filename);
-    std::string line;
-    std::shared_ptr<std::vector<UserInfo*>> UserInfoList = std::make_shared<std::vector<UserInfo*>>();
-
-    if (!file.is_open())
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDirectory, error);
+    if (error)
     {
-        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + filename);
+        throw std::runtime_error("Cannot create report directory: " + options.outputDirectory);
     }
 
-    std::ifstream ifs(filename, std::ios::ate); // std::ios::ate means open at end to check if file is empty
-    if (ifs.tellg() == 0)
+    const std::size_t usersPerFile = std::max<std::size_t>(1, options.usersPerFile);
+    const std::size_t fileCount = (userInfoList.size() + usersPerFile - 1) / usersPerFile;
+
+    std::uint64_t names = 0;
+    for (const UserInfo *user : userInfoList)
     {
-        throw std::runtime_error("File is empty: " + filename);
+        names = (names * 0x100000001b3ULL) ^ hashName(user->name);
     }
-
-    while (getline(file, line))
+    char manifest[192];
+    std::snprintf(manifest, sizeof(manifest), "# report-job users=%zu first=%llu last=%llu names=%016llx per-file=%zu formula=%d\n",
+                  userInfoList.size(), static_cast<unsigned long long>(userIds.empty() ? 0 : userIds.front()),
+                  static_cast<unsigned long long>(userIds.empty() ? 0 : userIds.back()), static_cast<unsigned long long>(names),
+                  usersPerFile, kFormulaVersion);
+    const std::filesystem::path manifestPath = std::filesystem::path(options.outputDirectory) / "report-job.manifest";
+    std::ifstream previousManifest(manifestPath, std::ios_base::binary);
+    std::string previous((std::istreambuf_iterator<char>(previousManifest)), std::istreambuf_iterator<char>());
+    previousManifest.close();
+    const bool resume = previous == manifest;
+
+    // Leftovers of earlier runs: temporary files always, report files unless this job is resumed
+    if (!resume && std::filesystem::exists(manifestPath) && !std::filesystem::remove(manifestPath, error))
     {
-        std::istringstream iss(line);
-        std::string token;
-        UserInfo *user = new UserInfo;
-
-        getline(iss, user->name, ',');
-        getline(iss, user->gender, ',');
-        getline(iss, token, ',');
-        user->age = std::stoi(token);
-        getline(iss, token, ',');
-        user->weight = std::stod(token);
-        getline(iss, token, ',');
-        user->waist = std::stod(token);
-        getline(iss, token, ',');
-        user->neck = std::stod(token);
-
-        // Check for hip measurement
-        getline(iss, token, ',');
-        user->hip = token.empty() ? 0.0 : std::stod(token); // ok to convert if token is not empty
-
-        getline(iss, token, ',');
-        user->height = std::stod(token);
-        getline(iss, user->lifestyle);
+        throw std::runtime_error("Cannot remove report manifest: " + manifestPath.string());
+    }
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(options.outputDirectory, error))
+    {
+        std::string name = entry.path().filename().string();
+        bool numbered = name.size() > 9 && std::all_of(name.begin(), name.begin() + 8, [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })
+                        && name[8] == '-';
+        bool jobFile = numbered || name.rfind("reports-", 0) == 0 || name.rfind("report-job.manifest", 0) == 0;
+        bool temporary = name.find(".tmp.") != std::string::npos;
+        bool report = !temporary && name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0;
+        if (jobFile && (temporary || (report && !resume)))
+        {
+            std::error_code removeError;
+            std::filesystem::remove(entry.path(), removeError);
+        }
+    }
+    if (error)
+    {
+        throw std::runtime_error("Cannot list report directory: " + options.outputDirectory);
+    }
+    if (!resume)
+    {
+        BufferedFileWriter file(manifestPath.string(), WriteMode::Rewrite);
+        if (!file.isOpen())
+        {
+            throw std::runtime_error("Cannot open report manifest: " + manifestPath.string());
+        }
+        file.append(manifest);
+        file.commit();
+    }
+    auto fileName = [&](std::size_t file) {
+        char number[24];
+        std::snprintf(number, sizeof(number), "%08zu", file * usersPerFile);
+        if (usersPerFile > 1)
+        {
+            return "reports-" + std::string(number) + ".txt";
+        }
 
+        std::string name = userInfoList[file]->name.substr(0, 64);
+        for (char &c : name)
+        {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_')
+            {
+                c = '_';
+            }
+        }
+        return std::string(number) + "-" + name + ".txt";
+    };
 
-        if (bfpType == BfpType::BmiMethod)
+    std::atomic<std::size_t> filesWritten{ 0 }, filesSkipped{ 0 }, usersWritten{ 0 };
+    std::atomic<std::uintmax_t> bytesWritten{ 0 };
+    ThreadPool::shared().run(fileCount, options.threadCount, [&](std::size_t file) {
+        std::filesystem::path path = std::filesystem::path(options.outputDirectory) / fileName(file);
+        std::error_code exists;
+        if (std::filesystem::exists(path, exists))
         {
-            bmiMethod(user);
+            filesSkipped++;
+            return;
         }
-        else if (bfpType == BfpType::USNavyMethod)
+
+        std::size_t begin = file * usersPerFile;
+        std::size_t end = std::min(userInfoList.size(), begin + usersPerFile);
+        ProfileRenderer renderer;
+        BufferedFileWriter writer(path.string(), WriteMode::Rewrite);
+        if (!writer.isOpen())
         {
-            usNavyMethod(user);
+            throw std::runtime_error("Cannot open report file: " + path.string());
         }
 
-        getDailyCalories(user);
-        getMealPrep(user);
+        std::uintmax_t bytes = 0;
+        for (std::size_t i = begin; i < end; i++)
+        {
+            renderer.render(userInfoList[i]);
+            if (renderer.size() >= BufferedFileWriter::kFlushThreshold || i + 1 == end)
+            {
+                writer.append(renderer.text());
+                bytes += renderer.size();
+                renderer.clear();
+            }
+        }
+        writer.commit();
+
+        filesWritten++;
+        usersWritten += end - begin;
+        bytesWritten += bytes;
+    });
+
+    ReportJobResult result;
+    result.filesWritten = filesWritten;
+    result.filesSkipped = filesSkipped;
+    result.usersWritten = usersWritten;
+    result.bytesWritten = bytesWritten;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "reports: " << result.filesWritten << " files written, " << result.filesSkipped << " skipped, "
+              << result.usersWritten << " users in " << double_to_string(result.seconds, 2) << " s ("
+              << double_to_string(result.usersPerSecond(), 0) << " users/s, "
+              << double_to_string(result.seconds > 0 ? result.bytesWritten / result.seconds / 1e6 : 0.0, 1) << " MB/s)" << std::endl;
+    return result;
+}
 
-        UserInfoList->push_back(user);
+/**
+ * @brief Generates the weekly nutrition report of every user into a directory.
+ *
+ * Usage example:
+ * ReportJobOptions options;
+ * options.outputDirectory = "reports/week-12";
+ * options.usersPerFile = 1000;
+ * ha->generateReports(options);
+ *
+ * With options.compute set, BFP, daily calories and macros are first recomputed for every user
+ * with this assistant's method; the reports are then written by UserInfoManager::writeReports.
+ *
+ * @param options Output directory, sharding and thread count.
+ * @return ReportJobResult The files written and skipped, and the throughput.
+ * @throws std::runtime_error if the directory or a report file cannot be written.
+ */
+ReportJobResult HealthAssistant::generateReports(const ReportJobOptions &options)
+{
+    if (options.compute)
+    {
+        userInfoManager->recomputeAll([this](UserInfo *user) {
+            getBfp(user);
+            getDailyCalories(user);
+            getMealPrep(user);
+        });
     }
+    return userInfoManager->writeReports(options);
+}
 
-    file.close();
-    return UserInfoList;
+/**
+ * @brief Appends a row copied from another table.
+ *
+ * @param from The table the row is copied from.
+ * @param row Index of the row in from.
+ */
+void UserTable::appendRow(const UserTable &from, std::size_t row)
+{
+    names.push_back(from.names[row]);
+    distinctNames.add(hashName(from.names[row]));
+    gender.push_back(from.gender[row]);
+    lifestyle.push_back(from.lifestyle[row]);
+    category.push_back(from.category[row]);
+    for (std::size_t c = 0; c < kColumnCount; c++)
+    {
+        columns[c].push_back(from.columns[c][row]);
+    }
 }
 
 /**
- * @brief Calculates the body fat percentage (BFP) for a user using the US Navy method and assigns the result to the user object.
+ * @brief Exports the computed table of a data file in a columnar file split into row groups.
  *
- * This function calculates the body fat percentage for the specified user using the US Navy method.
- * The calculation is based on the user's gender, age, waist, hip, neck, and height.
- * If the user's age falls outside the permitted range, the function prints a message indicating that
- * the body fat category cannot be determined.
+ * Layout, in host byte order:
+ * - header: "HACOL1" padded to 8 bytes, u8 method, u64 row count
+ * - row groups of up to rowGroupSize rows, each holding
+ *   - u32 row count
+ *   - u32 name lengths followed by the name bytes
+ *   - gender, lifestyle and category dictionary-encoded: u8 dictionary size, then per entry
+ *     u8 label length and label, then one u8 dictionary index per row
+ *   - the numeric columns in Column order, as doubles
+ * - footer: u32 row group count, then per row group its u64 offset, u32 row count and the
+ *   min and max of every numeric column
+ * - u64 offset of the footer
  *
- * @param user A pointer to the UserInfo object containing the user's information.
+ * The footer lets LoadColumnar decide which row groups a filter can match before reading them.
+ * Rows are stably sorted by sortBy first, so the row groups cover narrow ranges of that column and
+ * range filters on it skip most of them; pass std::nullopt to keep the order of the data file.
+ *
+ * Usage example:
+ * stats.ExportColumnar("USArmy", "us_users.col");
+ *
+ * @param method "bmi" or "USArmy"; each file holds one method's results.
+ * @param path The file written, replaced atomically.
+ * @param rowGroupSize Number of rows per row group.
+ * @param sortBy Column the rows are clustered by, or std::nullopt for file order.
+ * @throws std::runtime_error if the method is not a single method or the file cannot be written.
  */
-void UserStats::usNavyMethod(UserInfo *user)
+void UserStats::ExportColumnar(std::string method, const std::string &path, std::size_t rowGroupSize, std::optional<Column> sortBy)
 {
-    double bfp;
-    std::string category;
+    if (method != "bmi" && method != "USArmy")
+    {
+        throw std::runtime_error("Columnar export needs a single method (bmi or USArmy): " + method);
+    }
+    std::shared_ptr<const UserTable> table = loadTables(method).front();
+    rowGroupSize = std::max<std::size_t>(1, rowGroupSize);
 
-    if (user->gender == "female")
+    BufferedFileWriter file(path, WriteMode::Rewrite);
+    if (!file.isOpen())
     {
-        bfp = (495.0 / (1.29579 - 0.35004 * log10(user->waist + user->hip - user->neck) + 0.22100 * log10(user->height))) - 450.0;
+        throw std::runtime_error("Cannot open file for writing: " + path);
+    }
 
-        if (user->age >= 20 && user->age <= 39)
-        {
-            if (bfp < 21)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 33)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 39)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
-        }
-        else if (user->age >= 40 && user->age <= 59)
+    std::uint64_t offset = 0;
+    auto put = [&](const void *data, std::size_t size) {
+        file.append(std::string_view(static_cast<const char*>(data), size));
+        offset += size;
+    };
+    auto putValue = [&](auto value) { put(&value, sizeof(value)); };
+    // Writes a categorical column as a dictionary of labels and one index per row
+    auto putDictionary = [&](const std::uint8_t *codes, std::size_t count, auto codeName) {
+        std::array<std::int16_t, 256> index;
+        index.fill(-1);
+        std::vector<std::uint8_t> dictionary;
+        for (std::size_t i = 0; i < count; i++)
         {
-            if (bfp < 23)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 34)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 40)
-            {
-                category = "USNavy: High";
-            }
-            else
+            if (index[codes[i]] < 0)
             {
-                category = "USNavy: Very High";
+                index[codes[i]] = static_cast<std::int16_t>(dictionary.size());
+                dictionary.push_back(codes[i]);
             }
         }
-        else if (user->age >= 60 && user->age <= 79)
+        putValue(static_cast<std::uint8_t>(dictionary.size()));
+        for (std::uint8_t code : dictionary)
         {
-            if (bfp < 24)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 36)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 42)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            std::string label = codeName(code);
+            putValue(static_cast<std::uint8_t>(label.size()));
+            put(label.data(), label.size());
         }
-        else
+        for (std::size_t i = 0; i < count; i++)
         {
-            std::cout << "The body fat category cannot be determined because you are outside of the permitted age range." << std::endl;
+            putValue(static_cast<std::uint8_t>(index[codes[i]]));
         }
+    };
+
+    struct RowGroupIndex {
+        std::uint64_t offset;
+        std::uint32_t rows;
+        std::array<double, kColumnCount> min;
+        std::array<double, kColumnCount> max;
+    };
+    std::vector<RowGroupIndex> groups;
+
+    std::vector<std::uint32_t> order(table->size());
+    std::iota(order.begin(), order.end(), 0u);
+    if (sortBy)
+    {
+        const std::vector<double> &key = table->column(*sortBy);
+        std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return key[a] < key[b]; });
     }
-    else if (user->gender == "male")
+    std::vector<std::uint8_t> codes;
+    std::vector<double> values;
+
+    put("HACOL1\0\0", 8);
+    putValue(static_cast<std::uint8_t>(table->bfpType));
+    putValue(static_cast<std::uint64_t>(table->size()));
+
+    for (std::size_t begin = 0; begin < table->size(); begin += rowGroupSize)
     {
-        bfp = (495.0 / (1.0324 - 0.19077 * log10(user->waist - user->neck) + 0.15456 * log10(user->height))) - 450.0;
-        if (user->age >= 20 && user->age <= 39)
+        std::size_t end = std::min(table->size(), begin + rowGroupSize);
+        RowGroupIndex group;
+        group.offset = offset;
+        group.rows = static_cast<std::uint32_t>(end - begin);
+        putValue(group.rows);
+
+        for (std::size_t i = begin; i < end; i++)
         {
-            if (bfp < 8)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 20)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 25)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            putValue(static_cast<std::uint32_t>(table->names[order[i]].size()));
         }
-        else if (user->age >= 40 && user->age <= 59)
+        for (std::size_t i = begin; i < end; i++)
         {
-            if (bfp < 11)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 22)
-            {
-                category = "USNavy: Normal";
-            }
-            else if (bfp < 28)
-            {
-                category = "USNavy: High";
-            }
-            else
-            {
-                category = "USNavy: Very High";
-            }
+            put(table->names[order[i]].data(), table->names[order[i]].size());
         }
-        else if (user->age >= 60 && user->age <= 79)
-        {
-            if (bfp < 13)
-            {
-                category = "USNavy: Low";
-            }
-            else if (bfp < 25)
+
+        auto gather = [&](const auto &column) {
+            codes.clear();
+            for (std::size_t i = begin; i < end; i++)
             {
-                category = "USNavy: Normal";
+                codes.push_back(static_cast<std::uint8_t>(column[order[i]]));
             }
-            else if (bfp < 30)
+            return codes.data();
+        };
+        putDictionary(gather(table->gender), end - begin,
+                      [](std::uint8_t code) { return genderName(static_cast<Gender>(code)); });
+        putDictionary(gather(table->lifestyle), end - begin,
+                      [](std::uint8_t code) { return lifestyleName(static_cast<Lifestyle>(code)); });
+        putDictionary(gather(table->category), end - begin,
+                      [](std::uint8_t code) { return categoryName(static_cast<BfpCategory>(code)); });
+
+        for (std::size_t c = 0; c < kColumnCount; c++)
+        {
+            values.clear();
+            for (std::size_t i = begin; i < end; i++)
             {
-                category = "USNavy: High";
+                values.push_back(table->columns[c][order[i]]);
             }
-            else
+            double low = std::numeric_limits<double>::infinity(), high = -low;
+            for (double value : values)
             {
-                category = "USNavy: Very High";
+                if (std::isnan(value))
+                {
+                    // NaN compares false with everything; widen the range so the block is never skipped on it
+                    low = -std::numeric_limits<double>::infinity();
+                    high = std::numeric_limits<double>::infinity();
+                    break;
+                }
+                low = std::min(low, value);
+                high = std::max(high, value);
             }
+            group.min[c] = low;
+            group.max[c] = high;
+            put(values.data(), values.size() * sizeof(double));
         }
-        else
-        {
-            std::cout << "The body fat category cannot be determined because you are outside of the permitted age range." << std::endl;
-        }
+        groups.push_back(group);
     }
 
-    // Return Body Fat Percentage (BFP) and category as a pair
-    user->bfp = std::make_pair(static_cast<int>(bfp), category);
+    std::uint64_t footer = offset;
+    putValue(static_cast<std::uint32_t>(groups.size()));
+    for (const RowGroupIndex &group : groups)
+    {
+        putValue(group.offset);
+        putValue(group.rows);
+        put(group.min.data(), sizeof(double) * kColumnCount);
+        put(group.max.data(), sizeof(double) * kColumnCount);
+    }
+    putValue(footer);
+    file.commit();
 }
 
 /**
- * @brief Calculates the body fat percentage (BFP) for a user using the BMI method and assigns the result to the user object.
+ * @brief Loads the rows of a columnar export matching a filter, reading only the row groups that can match.
  *
- * This function calculates the body fat percentage for the specified user using the BMI method.
- * The calculation is based on the user's weight and height.
+ * The footer is read first; a row group is skipped without being read or decoded when the min/max
+ * statistics of a numeric condition rule it out, e.g. a group with ages 20 to 38 for the filter
+ * age >= 40 and age <= 59. The remaining groups are decoded and filtered row by row. The result is
+ * an ordinary table, usable with the query functions that take one.
  *
- * @param user A pointer to the UserInfo object containing the user's information.
+ * Usage example:
+ * ColumnarScanStats scan;
+ * auto table = stats.LoadColumnar("us_users.col", { Condition::on(Column::Age, CompareOp::GreaterEqual, 40),
+ *                                                   Condition::on(Column::Age, CompareOp::LessEqual, 59) }, &scan);
+ *
+ * @param path The file written by ExportColumnar.
+ * @param where Conditions a row must satisfy; empty loads every row.
+ * @param scan If not null, receives how many row groups were skipped and rows decoded.
+ * @return std::shared_ptr<const UserTable> The matching rows, in file order.
+ * @throws std::runtime_error if the file cannot be read or is not a columnar export.
  */
-void UserStats::bmiMethod(UserInfo *user)
+std::shared_ptr<const UserTable> UserStats::LoadColumnar(const std::string &path, const std::vector<Condition> &where,
+                                                         ColumnarScanStats *scan)
 {
-    double bfp;
-    std::string category;
-
-    bfp = (user->weight*100*100)/(user->height*user->height);
-
-    if (bfp < 18.5)
+    std::ifstream file(path, std::ios_base::binary);
+    if (!file.is_open())
     {
-        category = "Bmi: Low";
+        throw std::runtime_error("Cannot open file as it may not exist or cannot be opened: " + path);
     }
-    else if (bfp < 25)
+    auto fail = [&]() -> void { throw std::runtime_error("Not a valid columnar export: " + path); };
+    auto get = [&](void *data, std::size_t size) {
+        if (!file.read(static_cast<char*>(data), static_cast<std::streamsize>(size)))
+        {
+            fail();
+        }
+    };
+    auto getValue = [&](auto &value) { get(&value, sizeof(value)); };
+
+    // Every count read from the file is checked against the file size before anything is allocated
+    const std::uint64_t headerSize = 8 + sizeof(std::uint8_t) + sizeof(std::uint64_t);
+    const std::uint64_t indexEntrySize = sizeof(std::uint64_t) + sizeof(std::uint32_t) + 2 * sizeof(double) * kColumnCount;
+    const std::uint64_t minRowSize = sizeof(std::uint32_t) + 3 + sizeof(double) * kColumnCount; // name length, 3 codes, numbers
+    file.seekg(0, std::ios_base::end);
+    const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(0);
+    if (fileSize < headerSize + sizeof(std::uint32_t) + sizeof(std::uint64_t))
     {
-        category = "Bmi: Normal";
+        fail();
     }
-    else if (bfp < 30)
+
+    char magic[8];
+    std::uint8_t bfpType = 0;
+    std::uint64_t rowCount = 0;
+    get(magic, sizeof(magic));
+    if (std::memcmp(magic, "HACOL1\0\0", 8) != 0)
     {
-        category = "Bmi: High";
+        fail();
     }
-    else
+    getValue(bfpType);
+    getValue(rowCount);
+    if (bfpType > static_cast<std::uint8_t>(BfpType::USNavyMethod))
     {
-        category = "Bmi: Very High";
+        fail();
     }
 
-    // Return Body Fat Percentage (BFP) and category as a pair
-    user->bfp = std::make_pair(static_cast<int>(bfp), category);
-}
-
-/**
- * @brief Calculates the daily caloric intake for a user based on gender, age, and lifestyle.
- *
- * This function calculates the daily caloric intake for the specified user based on their gender,
- * age, and lifestyle (sedentary, moderate, or active). The calculation follows standard guidelines
- * for daily caloric needs according to gender, age group, and activity level.
- *
- * @param user A pointer to the UserInfo object containing the user's information.
- */
-void UserStats::getDailyCalories(UserInfo *user)
-{
-    int calories = 0;
+    std::uint64_t footer = 0;
+    file.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios_base::end);
+    getValue(footer);
+    if (footer < headerSize || footer > fileSize - sizeof(std::uint32_t) - sizeof(std::uint64_t))
+    {
+        fail();
+    }
+    file.seekg(static_cast<std::streamoff>(footer));
+    std::uint32_t groupCount = 0;
+    getValue(groupCount);
+    if (fileSize - sizeof(std::uint64_t) - sizeof(std::uint32_t) - footer != groupCount * indexEntrySize)
+    {
+        fail();
+    }
 
-    if (user->gender == "male")
+    struct RowGroupIndex {
+        std::uint64_t offset;
+        std::uint64_t end;          // where the next row group or the footer starts
+        std::uint32_t rows;
+        std::array<double, kColumnCount> min;
+        std::array<double, kColumnCount> max;
+    };
+    std::vector<RowGroupIndex> groups(groupCount);
+    for (RowGroupIndex &group : groups)
     {
-        if (user->age >= 19 && user->age <= 30)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2400;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2800;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 3000;
-            }
-        }
-        else if (user->age >= 31 && user->age <= 50)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2200;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2600;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 3000;
-            }
-        }
-        else if (user->age > 50)
-        {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2000;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2400;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2800;
-            }
-        }
+        getValue(group.offset);
+        getValue(group.rows);
+        get(group.min.data(), sizeof(double) * kColumnCount);
+        get(group.max.data(), sizeof(double) * kColumnCount);
     }
-    else if (user->gender == "female")
+
+    // Row groups must tile the space between the header and the footer, each large enough for its rows
+    std::uint64_t totalRows = 0;
+    for (std::size_t g = 0; g < groups.size(); g++)
     {
-        if (user->age >= 19 && user->age <= 30)
+        RowGroupIndex &group = groups[g];
+        group.end = g + 1 < groups.size() ? groups[g + 1].offset : footer;
+        if (group.offset != (g == 0 ? headerSize : groups[g - 1].end) || group.end > footer || group.end < group.offset
+            || group.end - group.offset < sizeof(std::uint32_t) + group.rows * minRowSize)
         {
-            if (user->lifestyle == "sedentary")
-            {
-                calories = 2000;
-            }
-            else if (user->lifestyle == "moderate")
-            {
-                calories = 2200;
-            }
-            else if (user->lifestyle == "active")
-            {
-                calories = 2400;
-            }
+            fail();
         }
-        else if (user->age >= 31 && user->age <= 50)
+        totalRows += group.rows;
+    }
+    if (totalRows != rowCount || (groups.empty() ? headerSize : groups.back().end) != footer)
+    {
+        fail();
+    }
+
+    // Whether the min/max statistics of a row group leave any row able to satisfy every condition
+    auto mayMatch = [&](const RowGroupIndex &group) {
+        for (const Condition &condition : where)
         {
-            if (user->lifestyle == "sedentary")
+            if (condition.field != Field::Numeric)
             {
-                calories = 1800;
+                continue;
             }
-            else if (user->lifestyle == "moderate")
+            double low = group.min[static_cast<std::size_t>(condition.column)];
+            double high = group.max[static_cast<std::size_t>(condition.column)];
+            double value = condition.value;
+            bool possible = true;
+            switch (condition.op)
             {
-                calories = 2000;
+                case CompareOp::Equal: possible = value >= low && value <= high; break;
+                case CompareOp::NotEqual: possible = !(low == value && high == value); break;
+                case CompareOp::Less: possible = low < value; break;
+                case CompareOp::LessEqual: possible = low <= value; break;
+                case CompareOp::Greater: possible = high > value; break;
+                case CompareOp::GreaterEqual: possible = high >= value; break;
             }
-            else if (user->lifestyle == "active")
+            if (!possible)
             {
-                calories = 2200;
+                return false;
             }
         }
-        else if (user->age > 50)
+        return true;
+    };
+    // Reads a dictionary-encoded column, mapping its labels back to codes
+    auto getDictionary = [&](std::uint8_t *codes, std::size_t count, auto codeOf) {
+        std::uint8_t size = 0;
+        getValue(size);
+        std::array<std::uint8_t, 256> dictionary{};
+        std::string label;
+        for (std::size_t entry = 0; entry < size; entry++)
         {
-            if (user->lifestyle == "sedentary")
+            std::uint8_t length = 0;
+            getValue(length);
+            label.resize(length);
+            get(label.data(), length);
+            dictionary[entry] = codeOf(label);
+        }
+        get(codes, count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (codes[i] >= size)
             {
-                calories = 1600;
+                fail();
             }
-            else if (user->lifestyle == "moderate")
+            codes[i] = dictionary[codes[i]];
+        }
+    };
+
+    std::shared_ptr<UserTable> table = std::make_shared<UserTable>();
+    table->bfpType = static_cast<BfpType>(bfpType);
+    ColumnarScanStats stats;
+    stats.rowGroups = groups.size();
+    UserTable block;
+    std::vector<std::uint8_t> mask;
+    std::vector<std::uint32_t> lengths;
+
+    for (const RowGroupIndex &group : groups)
+    {
+        if (!mayMatch(group))
+        {
+            stats.rowGroupsSkipped++;
+            continue;
+        }
+
+        file.seekg(static_cast<std::streamoff>(group.offset));
+        std::uint32_t rows = 0;
+        getValue(rows);
+        if (rows != group.rows)
+        {
+            fail();
+        }
+
+        lengths.resize(rows);
+        get(lengths.data(), rows * sizeof(std::uint32_t));
+        std::uint64_t nameBytes = 0;
+        for (std::uint32_t length : lengths)
+        {
+            nameBytes += length;
+        }
+        if (nameBytes > group.end - group.offset - sizeof(std::uint32_t) - rows * minRowSize)
+        {
+            fail();
+        }
+        block.names.resize(rows);
+        for (std::size_t i = 0; i < rows; i++)
+        {
+            block.names[i].resize(lengths[i]);
+            get(block.names[i].data(), lengths[i]);
+        }
+
+        block.gender.resize(rows);
+        block.lifestyle.resize(rows);
+        block.category.resize(rows);
+        getDictionary(reinterpret_cast<std::uint8_t*>(block.gender.data()), rows,
+                      [](const std::string &label) { return static_cast<std::uint8_t>(genderFromString(label)); });
+        getDictionary(reinterpret_cast<std::uint8_t*>(block.lifestyle.data()), rows,
+                      [](const std::string &label) { return static_cast<std::uint8_t>(lifestyleFromString(label)); });
+        getDictionary(reinterpret_cast<std::uint8_t*>(block.category.data()), rows, [](const std::string &label) {
+            std::uint8_t code = static_cast<std::uint8_t>(BfpCategory::VeryHigh);
+            while (code > 0 && categoryName(static_cast<BfpCategory>(code)) != label)
             {
-                calories = 1800;
+                code--;
             }
-            else if (user->lifestyle == "active")
+            return code;
+        });
+        for (std::vector<double> &column : block.columns)
+        {
+            column.resize(rows);
+            get(column.data(), rows * sizeof(double));
+        }
+
+        mask.assign(rows, 1);
+        for (const Condition &condition : where)
+        {
+            applyCondition(&block, condition, 0, rows, mask.data());
+        }
+        for (std::size_t i = 0; i < rows; i++)
+        {
+            if (mask[i])
             {
-                calories = 2200;
+                table->appendRow(block, i);
             }
         }
-    } else {
-        std::cerr << "This is ackward, your intake calarie wasn't able to be processed" << std::endl;
-        calories = 0;
+        stats.rowsDecoded += rows;
     }
 
-    user->daily_calories = calories;
+    stats.rowsMatched = table->size();
+    if (scan)
+    {
+        *scan = stats;
+    }
+    return table;
 }
 
 /**
- * @brief Calculates the macronutrient distribution for meal preparation based on daily caloric intake.
+ * @brief Parses one CSV user record, in the basic or the extended format.
  *
- * This function calculates the distribution of macronutrients (carbohydrates, protein, and fat)
- * for meal preparation based on the user's daily caloric intake. It defines the percentage of total
- * calories for each macronutrient and then calculates the calories and grams for carbohydrates, protein,
- * and fat accordingly.
+ * This is the record parser shared by readFromFile and both massLoadAndCompute functions.
+ * Basic records hold name,gender,age,weight,waist,neck,hip,height,lifestyle, with hip empty for
+ * male users. Extended records, written with ExportFormat::CsvWithResults, continue with
+ * method,formula_version,bfp,category,daily_calories,carbs,protein,fat. Stored results are only
+ * copied into the user when their formula version is kFormulaVersion.
  *
- * @param user A pointer to the UserInfo object containing the user's information.
+ * @param line The record, without its newline.
+ * @param user Receives the fields of the record.
+ * @return std::optional<BfpType> The method whose current results the record stored, or std::nullopt
+ *         when the record has no usable results and the user must be computed.
+ * @throws std::runtime_error if a numeric field is not a number.
  */
-void UserStats::getMealPrep(UserInfo *user)
+std::optional<BfpType> parseUserRecord(const std::string &line, UserInfo *user)
 {
-    // Define the percentage of total calories for each macronutrient
-    const double carbs_percentage = 0.50;
-    const double protein_percentage = 0.30;
-    const double fat_percentage = 0.20;
+    std::string_view rest(line);
+    auto next = [&]() {
+        std::size_t comma = rest.find(',');
+        std::string_view field = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+        return field;
+    };
+    auto number = [&](std::string_view field, auto &value) {
+        std::size_t start = field.find_first_not_of(" \t");
+        const char *first = field.data() + (start == std::string_view::npos ? field.size() : start);
+        if (std::from_chars(first, field.data() + field.size(), value).ec != std::errc())
+        {
+            throw std::runtime_error("Invalid number '" + std::string(field) + "' in user record: " + line);
+        }
+    };
 
-    // Calculate the calories for each macronutrient
-    double carbs_calories = user->daily_calories * carbs_percentage;
-    double protein_calories = user->daily_calories * protein_percentage;
-    double fat_calories = user->daily_calories * fat_percentage;
+    bool extended = std::count(line.begin(), line.end(), ',') >= 16;
+    user->name = next();
+    user->gender = next();
+    number(next(), user->age);
+    number(next(), user->weight);
+    number(next(), user->waist);
+    number(next(), user->neck);
+
+    // Check for hip measurement
+    std::string_view hip = next();
+    user->hip = 0.0;
+    if (!hip.empty())
+    {
+        number(hip, user->hip); // ok to convert if token is not empty
+    }
 
-    // Calculate the grams for each macronutrient
-    user->carbs = carbs_calories / 4.0;
-    user->protein = protein_calories / 4.0;
-    user->fat = fat_calories / 9.0;
+    number(next(), user->height);
+    if (!extended)
+    {
+        user->lifestyle = rest; // the rest of the line, as in the original format
+        return std::nullopt;
+    }
+    user->lifestyle = next();
+
+    std::string_view method = next();
+    int version = 0;
+    number(next(), version);
+    if (version != kFormulaVersion || (method != "bmi" && method != "usnavy"))
+    {
+        return std::nullopt;
+    }
+
+    number(next(), user->bfp.first);
+    user->bfp.second = next();
+    number(next(), user->daily_calories);
+    number(next(), user->carbs);
+    number(next(), user->protein);
+    number(next(), user->fat);
+    user->bfpType = method == "bmi" ? BfpType::BmiMethod : BfpType::USNavyMethod;
+    return user->bfpType;
 }
 
 /**
- * @brief Retrieves the names of healthy users based on the specified method and gender.
+ * @brief Returns the fraction of joined pairs on which both methods give the same category.
  *
- * This function retrieves the names of healthy users based on the specified method (BMI or US Navy)
- * and gender. It loads user information from the appropriate data file and computes the necessary
- * health-related metrics. Then, it filters users based on their gender and body fat percentage category
- * (e.g., "Bmi: Normal" for the BMI method or "USNavy: Normal" for the US Navy method) and returns
- * a vector containing the names of healthy users.
+ * @return double The agreement rate, 0 when nothing was joined.
+ */
+double MethodAgreement::agreementRate() const
+{
+    std::size_t agreeing = 0;
+    for (std::size_t c = 0; c < kCategories; c++)
+    {
+        agreeing += matrix[c][c];
+    }
+    return matched ? static_cast<double>(agreeing) / matched : 0.0;
+}
+
+/**
+ * @brief Joins the BMI and US Navy data files by name and measures how often their categories agree.
  *
- * @param method The method used to compute body fat percentage (BMI or US Navy).
- * @param gender The gender of users to retrieve (male or female).
- * @return A vector containing the names of healthy users based on the specified method and gender.
+ * When both tables are sorted by name they are merge-joined in one pass with no extra memory, and
+ * pairs come out in name order. Otherwise the smaller table is indexed in a hash table of name views
+ * with a chain of rows per name, and the larger one is streamed past it, so memory is bounded by the
+ * smaller table and pairs come out in the order of the larger one. A name occurring several times in
+ * both files yields every pair, as in an SQL inner join. Pairs are handed to visit as they are found
+ * rather than collected; the agreement matrix is printed when the join ends.
+ *
+ * Usage example:
+ * MethodAgreement agreement = stats.CompareMethods([](const JoinedUser &user) {
+ *     if (!user.agree()) { ... }
+ * });
+ *
+ * @param visit Optional function called with every joined pair.
+ * @return MethodAgreement The join counts and the agreement matrix.
  */
-std::vector<std::string> UserStats::GetHealthyUsers(std::string method, std::string gender)
+MethodAgreement UserStats::CompareMethods(const std::function<void(const JoinedUser&)> &visit)
 {
-    std::vector<std::string> healthyUsers;
-    std::shared_ptr<std::vector<UserInfo*>> userStats;
-    if (method == "bmi")
+    std::shared_ptr<const UserTable> bmi = loadTable("bmi_user_data.csv", BfpType::BmiMethod);
+    std::shared_ptr<const UserTable> usNavy = loadTable("us_user_data.csv", BfpType::USNavyMethod);
+    MethodAgreement agreement;
+    std::vector<std::uint8_t> bmiMatched(bmi->size()), usNavyMatched(usNavy->size());
+
+    auto emit = [&](std::size_t bmiRow, std::size_t usNavyRow) {
+        JoinedUser user;
+        user.name = bmi->names[bmiRow];
+        user.bmiRow = static_cast<std::uint32_t>(bmiRow);
+        user.usNavyRow = static_cast<std::uint32_t>(usNavyRow);
+        user.bmiCategory = bmi->category[bmiRow];
+        user.usNavyCategory = usNavy->category[usNavyRow];
+        agreement.matched++;
+        agreement.matrix[static_cast<std::size_t>(user.bmiCategory)][static_cast<std::size_t>(user.usNavyCategory)]++;
+        bmiMatched[bmiRow] = 1;
+        usNavyMatched[usNavyRow] = 1;
+        if (visit)
+        {
+            visit(user);
+        }
+    };
+
+    agreement.mergeJoin = std::is_sorted(bmi->names.begin(), bmi->names.end()) && std::is_sorted(usNavy->names.begin(), usNavy->names.end());
+    if (agreement.mergeJoin)
     {
-        userStats = massLoadAndCompute("bmi_user_data.csv", BfpType::BmiMethod);
-        for (auto user: *userStats)
+        std::size_t i = 0, j = 0;
+        while (i < bmi->size() && j < usNavy->size())
         {
-            if (user->gender == gender && user->bfp.second == "Bmi: Normal")
+            int order = bmi->names[i].compare(usNavy->names[j]);
+            if (order < 0)
+            {
+                i++;
+            }
+            else if (order > 0)
             {
-                healthyUsers.push_back(user->name);
+                j++;
+            }
+            else
+            {
+                // Pair up the runs of equal names on both sides
+                std::size_t iEnd = i, jEnd = j;
+                while (iEnd < bmi->size() && bmi->names[iEnd] == bmi->names[i]) iEnd++;
+                while (jEnd < usNavy->size() && usNavy->names[jEnd] == usNavy->names[j]) jEnd++;
+                for (std::size_t a = i; a < iEnd; a++)
+                {
+                    for (std::size_t b = j; b < jEnd; b++)
+                    {
+                        emit(a, b);
+                    }
+                }
+                i = iEnd;
+                j = jEnd;
             }
         }
     }
-    else if (method == "USArmy")
+    else
     {
-        userStats = massLoadAndCompute("us_user_data.csv", BfpType::USNavyMethod);
-        for (auto user: *userStats)
+        bool buildOnBmi = bmi->size() <= usNavy->size();
+        const UserTable &build = buildOnBmi ? *bmi : *usNavy;
+        const UserTable &probe = buildOnBmi ? *usNavy : *bmi;
+        const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+        // First row of each name, and for every row the next row of the same name
+        std::unordered_map<std::string_view, std::uint32_t> first(build.size());
+        std::vector<std::uint32_t> next(build.size(), none);
+        for (std::size_t row = build.size(); row-- > 0;)
+        {
+            auto inserted = first.emplace(build.names[row], static_cast<std::uint32_t>(row));
+            if (!inserted.second)
+            {
+                next[row] = inserted.first->second;
+                inserted.first->second = static_cast<std::uint32_t>(row);
+            }
+        }
+
+        for (std::size_t row = 0; row < probe.size(); row++)
         {
-            if (user->gender == gender && user->bfp.second == "USNavy: Normal")
+            auto found = first.find(probe.names[row]);
+            if (found == first.end())
+            {
+                continue;
+            }
+            for (std::uint32_t match = found->second; match != none; match = next[match])
             {
-                healthyUsers.push_back(user->name);
+                if (buildOnBmi)
+                {
+                    emit(match, row);
+                }
+                else
+                {
+                    emit(row, match);
+                }
             }
         }
     }
 
-    std::cout << "Healthy Users (" << gender << ", " << method << " method):" << std::endl;
-    for (auto name : healthyUsers)
+    agreement.bmiOnly = std::count(bmiMatched.begin(), bmiMatched.end(), 0);
+    agreement.usNavyOnly = std::count(usNavyMatched.begin(), usNavyMatched.end(), 0);
+
+    std::cout << "BMI vs US Navy categories (" << (agreement.mergeJoin ? "merge" : "hash") << " join): " << agreement.matched
+              << " pairs, " << agreement.bmiOnly << " bmi only, " << agreement.usNavyOnly << " us only, "
+              << double_to_string(agreement.agreementRate() * 100, 1) << "% agree" << std::endl;
+    std::cout << "bmi \\ us";
+    for (std::size_t c = 0; c < MethodAgreement::kCategories; c++)
     {
-        std::cout << name << std::endl;
+        std::cout << ", " << categoryName(static_cast<BfpCategory>(c));
     }
-
-    return healthyUsers;
+    std::cout << std::endl;
+    for (std::size_t r = 0; r < MethodAgreement::kCategories; r++)
+    {
+        std::cout << categoryName(static_cast<BfpCategory>(r));
+        for (std::size_t c = 0; c < MethodAgreement::kCategories; c++)
+        {
+            std::cout << ", " << agreement.matrix[r][c];
+        }
+        std::cout << std::endl;
+    }
+    return agreement;
 }
 
 /**
- * @brief Retrieves the names of healthy users based on the specified method.
+ * @brief Writes the users into shard files partitioned by a hash of their name, plus a manifest.
  *
- * This function retrieves the names of healthy users based on the specified method (BMI or US Navy).
- * It loads user information from the appropriate data files, computes the necessary health-related metrics,
- * and filters users based on their body fat percentage category (e.g., "Bmi: Normal" for the BMI method
- * or "USNavy: Normal" for the US Navy method). The function returns a vector containing the names of
- * healthy users regardless of gender.
+ * A user goes to shard hashName(name) % shardCount, so every record of a name lands in the same
+ * shard and loaders can each take a shard with no coordination. For filename "users.csv" and 4
+ * shards the files are users-00000-of-00004.csv to users-00003-of-00004.csv, written concurrently on
+ * the shared ThreadPool, and the manifest users.manifest lists them:
  *
- * @param method The method used to compute body fat percentage (BMI or US Navy).
- * @return A vector containing the names of healthy users based on the specified method.
+ * # shards=4 hash=fnv1a64-splitmix64 format=csv
+ * users-00000-of-00004.csv,2513
+ * ...
+ *
+ * The previous manifest is removed first and every shard is written to a temporary file; the shards
+ * replace the old ones only once all of them are complete, and the new manifest is written last. A
+ * manifest on disk therefore always describes the shards next to it: if the export fails, the old
+ * shards may be partly replaced, but there is no manifest vouching for them.
+ *
+ * @param filename Base name of the shard files and the manifest.
+ * @param shardCount Number of shard files.
+ * @param format Row format of the shard files.
+ * @return std::vector<std::size_t> Number of users written to each shard.
+ * @throws std::runtime_error if a shard or the manifest cannot be written.
  */
-std::vector<std::string> UserStats::GetHealthyUsers(std::string method)
+std::vector<std::size_t> UserInfoManager::writeShards(std::string filename, std::size_t shardCount, ExportFormat format)
 {
-    std::vector<std::string> healthyUsers;
-    std::shared_ptr<std::vector<UserInfo*>> userStats;
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    shardCount = std::max<std::size_t>(1, shardCount);
+    std::filesystem::path base(filename);
+    std::string extension = base.extension().string();
+    std::filesystem::path stem = base;
+    stem.replace_extension();
+
+    std::vector<std::vector<std::uint32_t>> shards(shardCount);
+    for (std::size_t i = 0; i < userInfoList.size(); i++)
+    {
+        shards[hashName(userInfoList[i]->name) % shardCount].push_back(static_cast<std::uint32_t>(i));
+    }
 
-    userStats = massLoadAndCompute("bmi_user_data.csv", BfpType::BmiMethod);
-    for (auto user: *userStats)
+    std::vector<std::string> names(shardCount);
+    for (std::size_t shard = 0; shard < shardCount; shard++)
     {
-        if (user->bfp.second == "Bmi: Normal")
-        {
-            healthyUsers.push_back(user->name);
-        }
+        char suffix[48];
+        std::snprintf(suffix, sizeof(suffix), "-%05zu-of-%05zu", shard, shardCount);
+        names[shard] = stem.string() + suffix + extension;
     }
-    userStats = massLoadAndCompute("us_user_data.csv", BfpType::USNavyMethod);
-    for (auto user: *userStats)
+
+    const std::string manifestPath = stem.string() + ".manifest";
+    std::error_code removeError;
+    std::filesystem::remove(manifestPath, removeError);
+    if (removeError)
     {
-        if (user->bfp.second == "USNavy: Normal")
+        throw std::runtime_error("Cannot remove previous manifest file: " + manifestPath);
+    }
+
+    // Uncommitted writers remove their temporary files, so a failed shard leaves the old shards in place
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<BufferedFileWriter>> files(shardCount);
+    ThreadPool::shared().run(shardCount, threads, [&](std::size_t shard) {
+        files[shard] = std::make_unique<BufferedFileWriter>(names[shard], WriteMode::Rewrite);
+        BufferedFileWriter &file = *files[shard];
+        if (!file.isOpen())
+        {
+            throw std::runtime_error("Cannot open shard file: " + names[shard]);
+        }
+        for (std::uint32_t row : shards[shard])
         {
-            healthyUsers.push_back(user->name);
+            if (format == ExportFormat::JsonLines)
+            {
+                appendJsonRow(file, userInfoList[row]);
+            }
+            else
+            {
+                appendCsvRow(file, userInfoList[row], format == ExportFormat::CsvWithResults);
+            }
         }
+    });
+    ThreadPool::shared().run(shardCount, threads, [&](std::size_t shard) { files[shard]->commit(); });
+    files.clear();
+
+    static const char *const formatNames[] = { "csv", "csv-with-results", "jsonl" };
+    std::vector<std::size_t> counts(shardCount);
+    BufferedFileWriter manifest(manifestPath, WriteMode::Rewrite);
+    if (!manifest.isOpen())
+    {
+        throw std::runtime_error("Cannot open manifest file: " + manifestPath);
     }
-
-    std::cout << "All Healthy Users " << std::endl;
-    for (auto name : healthyUsers)
+    manifest.append("# shards=");
+    manifest.appendInteger(static_cast<long long>(shardCount));
+    manifest.append(" hash=fnv1a64-splitmix64 format=");
+    manifest.append(formatNames[static_cast<int>(format)]);
+    manifest.append('\n');
+    for (std::size_t shard = 0; shard < shardCount; shard++)
     {
-        std::cout << name << std::endl;
+        counts[shard] = shards[shard].size();
+        manifest.append(std::filesystem::path(names[shard]).filename().string());
+        manifest.append(',');
+        manifest.appendInteger(static_cast<long long>(counts[shard]));
+        manifest.append('\n');
     }
+    manifest.commit();
+    return counts;
+}
 
-    return healthyUsers;
+/**
+ * @brief Finds the user with a username in the snapshot.
+ *
+ * @param username The username of the user to look up.
+ * @return const UserInfo* The user, valid as long as the view, or nullptr if there is no such user.
+ */
+const UserInfo *UserSnapshotView::find(const std::string &username) const
+{
+    std::size_t index = snapshot->indexOf(username);
+    if (index == snapshot->size)
+    {
+        return nullptr;
+    }
+    return snapshot->segments[index / UserInfoManager::kSegmentSize]->users[index % UserInfoManager::kSegmentSize].get();
 }
 
 /**
- * @brief Retrieves the names of unfit users based on the specified method and gender.
+ * @brief Finds the position of the first user with a username.
  *
- * This function retrieves the names of unfit users based on the specified method (BMI or US Navy)
- * and gender. It loads user information from the appropriate data file, computes the necessary
- * health-related metrics, and filters users based on their gender and body fat percentage category.
- * Unfit users are those whose body fat percentage category does not match the "Normal" category
- * for the specified method.
+ * Searches the name index of each segment, so a lookup costs a binary search per segment instead
+ * of a comparison per user.
  *
- * @param method The method used to compute body fat percentage (BMI or US Navy).
- * @param gender The gender of users to retrieve (male or female).
- * @return A vector containing the names of unfit users based on the specified method and gender.
+ * @param username The username of the user to look up.
+ * @return std::size_t The position of the user in list order, or size if there is no such user.
  */
-std::vector<std::string> UserStats::GetUnfitUsers(std::string method, std::string gender)
+std::size_t UserSnapshot::indexOf(const std::string &username) const
 {
-    std::vector<std::string> healthyUsers;
-    std::shared_ptr<std::vector<UserInfo*>> userStats;
-    if (method == "bmi")
+    const std::uint64_t hash = hashName(username);
+    for (std::size_t segment = 0; segment < segments.size(); segment++)
     {
-        userStats = massLoadAndCompute("bmi_user_data.csv", BfpType::BmiMethod);
-        for (auto user: *userStats)
+        const std::vector<std::pair<std::uint64_t, std::uint32_t>> &index = *segments[segment]->nameIndex;
+        auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(hash, std::uint32_t(0)));
+        for (; it != index.end() && it->first == hash; ++it)
         {
-            if (user->gender == gender && user->bfp.second != "Bmi: Normal")
+            if (segments[segment]->users[it->second]->name == username)
             {
-                healthyUsers.push_back(user->name);
+                return segment * UserInfoManager::kSegmentSize + it->second;
             }
         }
     }
-    else if (method == "USArmy")
+    return size;
+}
+
+/**
+ * @brief Leaves the epoch pinned by the reader, making its slot available again.
+ */
+EpochReclaimer::Guard::~Guard()
+{
+    if (slot != nullptr)
     {
-        userStats = massLoadAndCompute("us_user_data.csv", BfpType::USNavyMethod);
-        for (auto user: *userStats)
-        {
-            if (user->gender == gender && user->bfp.second != "USNavy: Normal")
-            {
-                healthyUsers.push_back(user->name);
-            }
-        }
+        slot->epoch.store(0, std::memory_order_release);
+        slot->used.store(false, std::memory_order_release);
     }
+}
 
-    std::cout << "Unfit Users (" << gender << ", " << method << " method):" << std::endl;
-    for (auto name : healthyUsers)
+/**
+ * @brief Frees every retired object; no reader may be pinned any more.
+ */
+EpochReclaimer::~EpochReclaimer()
+{
+    for (std::pair<std::uint64_t, std::function<void()>> &entry : retired)
     {
-        std::cout << name << std::endl;
+        entry.second();
     }
-
-    return healthyUsers;
 }
 
 /**
- * @brief Retrieves the names of unfit users based on the specified method.
+ * @brief Pins the current epoch for the calling reader.
  *
- * This function retrieves the names of unfit users based on the specified method (BMI or US Navy).
- * It loads user information from the appropriate data files, computes the necessary health-related metrics,
- * and filters users based on their body fat percentage category. Unfit users are those whose body fat percentage
- * category does not match the "Normal" category for the specified method.
+ * The reader claims a free slot, starting from the one it used last so that a thread keeps to its
+ * own cache line, and announces the epoch in it before loading any published pointer. If all
+ * kMaxReaders slots are taken the reader yields until one is released.
  *
- * @param method The method used to compute body fat percentage (BMI or US Navy).
- * @return A vector containing the names of unfit users based on the specified method.
+ * @return Guard The pin, released when the guard is destroyed.
  */
-std::vector<std::string> UserStats::GetUnfitUsers(std::string method)
+EpochReclaimer::Guard EpochReclaimer::pin()
 {
-    std::vector<std::string> healthyUsers;
-    std::shared_ptr<std::vector<UserInfo*>> userStats;
-
-    userStats = massLoadAndCompute("bmi_user_data.csv", BfpType::BmiMethod);
-    for (auto user: *userStats)
+    static thread_local std::size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id()) % kMaxReaders;
+    for (std::size_t attempt = 0;; attempt++)
     {
-        if (user->bfp.second != "Bmi: Normal")
+        Slot &slot = slots[(hint + attempt) % kMaxReaders];
+        bool expected = false;
+        if (!slot.used.load(std::memory_order_relaxed) && slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
         {
-            healthyUsers.push_back(user->name);
+            hint = (hint + attempt) % kMaxReaders;
+            // Sequentially consistent, so that a writer that does not see this pin has already
+            // published the pointers this reader loads next.
+            slot.epoch.store(epoch.load());
+            return Guard(&slot);
         }
-    }
-    userStats = massLoadAndCompute("us_user_data.csv", BfpType::USNavyMethod);
-    for (auto user: *userStats)
-    {
-        if (user->bfp.second != "USNavy: Normal")
+        if (attempt % kMaxReaders == kMaxReaders - 1)
         {
-            healthyUsers.push_back(user->name);
+            std::this_thread::yield();
         }
     }
+}
 
-    std::cout << "All Unfit Users " << std::endl;
-    for (auto name : healthyUsers)
+/**
+ * @brief Retires an object whose replacement has already been published, then reclaims what it can.
+ *
+ * @param release Function freeing the object, called once no reader can be using it.
+ */
+void EpochReclaimer::retire(std::function<void()> release)
+{
+    std::uint64_t retiredIn = epoch.fetch_add(1) + 1;
     {
-        std::cout << name << std::endl;
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired.emplace_back(retiredIn, std::move(release));
     }
-
-    return healthyUsers;
+    reclaim();
 }
 
 /**
- * @brief Retrieves the full statistics regarding user health.
- *
- * This function computes and displays various statistics regarding user health,
- * including the total number of users, the percentage of male and female users,
- * and the percentage of users categorized as healthy based on BMI and US Navy methods.
+ * @brief Frees the retired objects whose grace period is over.
  *
- * It loads user information from BMI and US Navy data files, computes the necessary health-related metrics,
- * and calculates statistics such as the total number of users, the percentage of male and female users,
- * and the percentage of users with healthy body fat percentage categories for both methods.
+ * The grace period of an object ends when every pinned reader has pinned the epoch it was retired
+ * in or a later one; readers pinned earlier may still hold it.
  *
- * The function prints these statistics to the console.
+ * @return std::size_t The number of objects freed.
  */
-void UserStats::GetFullStats()
+std::size_t EpochReclaimer::reclaim()
 {
-    std::shared_ptr<std::vector<UserInfo*>> bmiUserStats;
-    std::shared_ptr<std::vector<UserInfo*>> usUserStats;
-    bmiUserStats = massLoadAndCompute("bmi_user_data.csv", BfpType::BmiMethod);
-    usUserStats = massLoadAndCompute("us_user_data.csv", BfpType::BmiMethod);
-    int maleCount = 0, femaleCount = 0;
-    int healthyBmiCount = 0, healthyUsArmyCount = 0;
-    int healthyMaleBmiCount = 0, healthyFemaleBmiCount = 0;
-    int healthyMaleUsArmyCount = 0, healthyFemaleUsArmyCount = 0;
-
-    // Total Users
-    int totalUsers = bmiUserStats->size() + usUserStats->size();
-
-    // Percentage of male users
-    for (auto user: *bmiUserStats)
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+    for (const Slot &slot : slots)
     {
-        if (user->gender == "female")
+        std::uint64_t pinned = slot.epoch.load();
+        if (pinned != 0)
         {
-            femaleCount++;
-        }
-        else if (user->gender == "male")
-        {
-            maleCount++;
-        }
-
-        if (user->bfp.second == "Bmi: Normal")
-        {
-            healthyBmiCount++;
-            if (user->gender == "female")
-            {
-                healthyFemaleBmiCount++;
-            }
-            else if (user->gender == "male")
-            {
-                healthyMaleBmiCount++;
-            }
+            oldest = std::min(oldest, pinned);
         }
     }
-    for (auto user: *usUserStats)
+
+    std::vector<std::function<void()>> expired;
     {
-        if (user->gender == "female")
-        {
-            femaleCount++;
-        }
-        else if (user->gender == "male")
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        auto keep = std::partition(retired.begin(), retired.end(),
+                                   [oldest](const std::pair<std::uint64_t, std::function<void()>> &entry) { return entry.first > oldest; });
+        for (auto it = keep; it != retired.end(); ++it)
         {
-            maleCount++;
+            expired.push_back(std::move(it->second));
         }
+        retired.erase(keep, retired.end());
+    }
 
-        if (user->bfp.second == "Bmi: Normal")
-        {
-            healthyUsArmyCount++;
-            if (user->gender == "female")
-            {
-                healthyFemaleUsArmyCount++;
-            }
-            else if (user->gender == "male")
-            {
-                healthyMaleUsArmyCount++;
-            }
-        }
+    for (std::function<void()> &release : expired)
+    {
+        release();
     }
-    // std::cout << totalUsers << std::endl;
-    // std::cout << femaleCount << std::endl;
-    // std::cout << maleCount << std::endl;
-    // std::cout << healthyBmiCount << std::endl;
-    // std::cout << healthyFemaleBmiCount << std::endl;
-    // std::cout << healthyMaleBmiCount << std::endl;
-    // std::cout << healthyUsArmyCount << std::endl;
-    // std::cout << healthyFemaleUsArmyCount << std::endl;
-    // std::cout << healthyMaleUsArmyCount << std::endl;
+    return expired.size();
+}
 
-    std::cout << "total users: " << totalUsers << std::endl;
-    std::cout << "male/female percentage: " << maleCount*100/totalUsers << "% / " << femaleCount*100/totalUsers << "%" << std::endl;
-    std::cout << "healty bmi: " << healthyBmiCount*100/bmiUserStats->size() << "%"<< std::endl;
-    std::cout << "healty bmi male/female: " << healthyMaleBmiCount*100/bmiUserStats->size() << "% / "  << healthyFemaleBmiCount*100/bmiUserStats->size() << "%" << std::endl;
-    std::cout << "healty us: " << healthyUsArmyCount*100/usUserStats->size() << "%"<< std::endl;
-    std::cout << "healty us male/female: " << healthyMaleUsArmyCount*100/usUserStats->size() << "% / " << healthyFemaleUsArmyCount*100/usUserStats->size() << "%"<< std::endl;
-}
\ No newline at end of file
+/**
+ * @brief Returns the number of retired objects still waiting for their grace period.
+ *
+ * @return std::size_t The number of objects not yet freed.
+ */
+std::size_t EpochReclaimer::pending() const
+{
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    return retired.size();
+}
@@ -0,0 +1,191 @@
+/**
+ * @file ColumnarTest.cpp
+ * @brief Round trip of UserStats::ExportColumnar and UserStats::LoadColumnar.
+ *
+ * Exports a generated data file, loads it back with and without filters and checks the rows and
+ * the row groups skipped from the footer statistics, then checks that truncated and corrupted files
+ * are rejected with std::runtime_error. Built with -fsanitize=address,undefined by "make test", so a
+ * corrupted file read out of bounds fails the test even when it does not throw.
+ */
+#define main healthAssistantMain
+#include "../HealthAssistant.cpp"
+#undef main
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+struct GeneratedUser {
+    std::string name;
+    int age;
+    double weight;
+    double height;
+};
+
+/**
+ * @brief Writes a data file of users with ages spread over 20-79 and returns them in file order.
+ */
+std::vector<GeneratedUser> writeDataFile(const std::string &filename, std::size_t count)
+{
+    std::vector<GeneratedUser> users;
+    std::ofstream file(filename);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        bool female = i % 3 == 0;
+        GeneratedUser user{ "user" + std::to_string(i), 20 + static_cast<int>((i * 37) % 60),
+                            55.0 + static_cast<double>(i % 45), 155.0 + static_cast<double>(i % 80) / 2 };
+        file << user.name << ',' << (female ? "female" : "male") << ',' << user.age << ',' << user.weight << ','
+             << 75.0 + static_cast<double>(i % 30) << ',' << 33.0 + static_cast<double>(i % 10) / 2 << ','
+             << (female ? "100.0" : "") << ',' << user.height << ",moderate\n";
+        users.push_back(user);
+    }
+    return users;
+}
+
+std::vector<char> readBytes(const std::string &path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+template <typename Value>
+void overwrite(std::vector<char> &bytes, std::size_t offset, Value value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+/**
+ * @brief Writes a corrupted copy of an export and checks that loading it throws.
+ */
+void expectRejected(UserStats &stats, const std::vector<char> &bytes, const std::string &what)
+{
+    {
+        std::ofstream file("corrupt.col", std::ios_base::binary | std::ios_base::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    try
+    {
+        stats.LoadColumnar("corrupt.col");
+        check(false, "a corrupted file is rejected: " + what);
+    }
+    catch (const std::runtime_error &)
+    {
+    }
+}
+
+} // namespace
+
+int main()
+{
+    Logger::shared().setLevel(LogLevel::Off);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("ColumnarTest." + std::to_string(getpid()));
+    std::filesystem::create_directories(directory);
+    std::filesystem::current_path(directory);
+
+    const std::size_t userCount = 1000;
+    const std::size_t rowGroupSize = 100;
+    std::vector<GeneratedUser> users = writeDataFile("us_user_data.csv", userCount);
+    UserStats stats;
+    stats.ExportColumnar("USArmy", "users.col", rowGroupSize, Column::Age);
+
+    // Every row comes back, clustered by age, with the measurements it was written with
+    ColumnarScanStats scan;
+    std::shared_ptr<const UserTable> all = stats.LoadColumnar("users.col", {}, &scan);
+    check(all->size() == userCount, "an unfiltered load returns every row");
+    check(all->bfpType == BfpType::USNavyMethod, "the method is kept");
+    check(scan.rowGroups == userCount / rowGroupSize && scan.rowGroupsSkipped == 0, "an unfiltered load reads every row group");
+    check(std::is_sorted(all->column(Column::Age).begin(), all->column(Column::Age).end()), "rows are clustered by age");
+    std::map<std::string, const GeneratedUser*> byName;
+    for (const GeneratedUser &user : users)
+    {
+        byName[user.name] = &user;
+    }
+    std::size_t mismatched = 0;
+    for (std::size_t row = 0; row < all->size(); row++)
+    {
+        auto it = byName.find(all->names[row]);
+        if (it == byName.end() || all->column(Column::Age)[row] != it->second->age
+            || all->column(Column::Weight)[row] != it->second->weight || all->column(Column::Height)[row] != it->second->height)
+        {
+            mismatched++;
+        }
+    }
+    check(mismatched == 0, "every row round-trips its name and measurements");
+
+    // A range filter on the sort column skips exactly the row groups its statistics rule out
+    std::vector<int> ages;
+    for (const GeneratedUser &user : users)
+    {
+        ages.push_back(user.age);
+    }
+    std::stable_sort(ages.begin(), ages.end());
+    std::size_t expectedSkipped = 0, expectedMatched = 0;
+    for (std::size_t begin = 0; begin < userCount; begin += rowGroupSize)
+    {
+        expectedSkipped += ages[begin + rowGroupSize - 1] < 40 || ages[begin] > 59;
+    }
+    for (int age : ages)
+    {
+        expectedMatched += age >= 40 && age <= 59;
+    }
+    std::shared_ptr<const UserTable> middle = stats.LoadColumnar("users.col", { Condition::on(Column::Age, CompareOp::GreaterEqual, 40),
+                                                                                 Condition::on(Column::Age, CompareOp::LessEqual, 59) }, &scan);
+    check(expectedSkipped > 0, "the test data leaves row groups to skip");
+    check(scan.rowGroupsSkipped == expectedSkipped, "row groups outside the age range are skipped");
+    check(scan.rowsDecoded == (scan.rowGroups - expectedSkipped) * rowGroupSize, "only the remaining row groups are decoded");
+    check(scan.rowsMatched == expectedMatched && middle->size() == expectedMatched, "the filter keeps exactly the rows in range");
+
+    // Conditions on categorical fields cannot skip row groups but still filter rows
+    std::shared_ptr<const UserTable> females = stats.LoadColumnar("users.col", { Condition::is(Gender::Female) }, &scan);
+    check(scan.rowGroupsSkipped == 0, "categorical conditions skip no row group");
+    check(females->size() == (userCount + 2) / 3, "the gender filter keeps every female user");
+
+    // Truncated and corrupted files are rejected before anything is read out of bounds
+    const std::vector<char> bytes = readBytes("users.col");
+    const std::size_t headerSize = 8 + 1 + 8;
+    std::uint64_t footer = 0;
+    std::memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+    for (std::size_t length : { std::size_t(0), std::size_t(7), headerSize, bytes.size() / 2, bytes.size() - 1 })
+    {
+        expectRejected(stats, std::vector<char>(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(length)),
+                       "truncated to " + std::to_string(length) + " bytes");
+    }
+    std::vector<char> corrupt = bytes;
+    corrupt[0] = 'X';
+    expectRejected(stats, corrupt, "bad magic");
+    corrupt = bytes;
+    overwrite(corrupt, 8, std::uint8_t(9));
+    expectRejected(stats, corrupt, "unknown method");
+    corrupt = bytes;
+    overwrite(corrupt, 9, std::uint64_t(userCount + 1));
+    expectRejected(stats, corrupt, "row count not matching the row groups");
+    corrupt = bytes;
+    overwrite(corrupt, bytes.size() - sizeof(footer), std::uint64_t(bytes.size()));
+    expectRejected(stats, corrupt, "footer offset past the end");
+    corrupt = bytes;
+    overwrite(corrupt, footer, std::numeric_limits<std::uint32_t>::max());
+    expectRejected(stats, corrupt, "huge row group count");
+    corrupt = bytes;
+    overwrite(corrupt, footer + sizeof(std::uint32_t), std::uint64_t(headerSize + 1));
+    expectRejected(stats, corrupt, "first row group not after the header");
+    corrupt = bytes;
+    overwrite(corrupt, footer + sizeof(std::uint32_t) + sizeof(std::uint64_t), std::numeric_limits<std::uint32_t>::max());
+    expectRejected(stats, corrupt, "row group claiming more rows than its bytes");
+    corrupt = bytes;
+    overwrite(corrupt, headerSize + sizeof(std::uint32_t), std::numeric_limits<std::uint32_t>::max());
+    expectRejected(stats, corrupt, "name longer than its row group");
+
+    std::filesystem::current_path(std::filesystem::temp_directory_path());
+    std::filesystem::remove_all(directory);
+    std::cout << (failures == 0 ? "ColumnarTest passed" : "ColumnarTest failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
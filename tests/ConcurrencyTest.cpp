@@ -0,0 +1,126 @@
+/**
+ * @file ConcurrencyTest.cpp
+ * @brief Stress test of UserInfoManager readers running alongside writers.
+ *
+ * Built with -fsanitize=thread by "make test": reader threads take snapshots, look users up and page
+ * through the list while a writer adds, recomputes and deletes users. The test fails on a data race
+ * reported by ThreadSanitizer or on a snapshot whose users disagree with its statistics.
+ */
+#define main healthAssistantMain
+#include "../HealthAssistant.cpp"
+#undef main
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Builds a batch of users with valid measurements; the caller hands them to a manager.
+ */
+std::vector<UserInfo*> makeUsers(std::size_t first, std::size_t count)
+{
+    std::vector<UserInfo*> users;
+    for (std::size_t i = first; i < first + count; i++)
+    {
+        UserInfo *user = new UserInfo;
+        user->name = "user" + std::to_string(i);
+        user->gender = i % 2 == 0 ? "male" : "female";
+        user->age = 20 + static_cast<int>(i % 60);
+        user->weight = 50.0 + static_cast<double>(i % 60);
+        user->waist = 70.0 + static_cast<double>(i % 40) / 2;
+        user->neck = 32.0 + static_cast<double>(i % 20) / 2;
+        user->hip = user->gender == "female" ? 95.0 + static_cast<double>(i % 30) / 2 : 0.0;
+        user->height = 150.0 + static_cast<double>(i % 90) / 2;
+        user->lifestyle = "moderate";
+        users.push_back(user);
+    }
+    return users;
+}
+
+} // namespace
+
+int main()
+{
+    Logger::shared().setLevel(LogLevel::Off);
+
+    const std::size_t batches = 8;
+    const std::size_t batchSize = 1000;
+    std::shared_ptr<UserInfoManager> manager = std::make_shared<UserInfoManager>();
+    BmiMethod bmi(manager);
+    std::atomic<bool> done{ false };
+    std::atomic<std::size_t> inconsistent{ 0 };
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; r++)
+    {
+        readers.emplace_back([&, r] {
+            while (!done)
+            {
+                UserSnapshotView view = manager->snapshot();
+                std::size_t visited = 0;
+                std::int64_t bfpSum = 0;
+                view.forEach([&](const UserInfo &user) {
+                    visited++;
+                    bfpSum += user.bfp.second.empty() ? 0 : user.bfp.first;
+                });
+                if (visited != view.size() || view.liveStats().users != view.size() || bfpSum != view.liveStats().bfpSum)
+                {
+                    inconsistent++;
+                }
+
+                std::shared_ptr<const UserInfo> user = manager->getUserInfo("user" + std::to_string(r * 7));
+                if (user != nullptr && user->name != "user" + std::to_string(r * 7))
+                {
+                    inconsistent++;
+                }
+                manager->findUser("user" + std::to_string(r * 13));
+                UserPage page = manager->getPage(std::string(), 50);
+                if (page.users.size() > 50)
+                {
+                    inconsistent++;
+                }
+                manager->getLiveStats();
+            }
+        });
+    }
+
+    std::thread writer([&] {
+        for (std::size_t batch = 0; batch < batches; batch++)
+        {
+            manager->addUsers(makeUsers(batch * batchSize, batchSize));
+            for (std::size_t i = 0; i < 50; i++)
+            {
+                bmi.getBfp("user" + std::to_string(batch * batchSize + i));
+            }
+            manager->deleteUser("user" + std::to_string(batch * batchSize + 1));
+        }
+        manager->recomputeAll([](UserInfo *user) { user->daily_calories = 2000; });
+    });
+
+    writer.join();
+    done = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    UserSnapshotView view = manager->snapshot();
+    check(inconsistent == 0, "readers saw snapshots disagreeing with their statistics");
+    check(view.size() == batches * (batchSize - 1), "every added user but the deleted ones is published");
+    check(view.liveStats().users == view.size(), "statistics count every published user");
+    check(view.liveStats().caloriesUsers == view.size(), "recomputeAll reached every user");
+    check(view.find("user1") == nullptr, "deleted users are not found");
+    check(view.find("user0") != nullptr && !view.find("user0")->bfp.second.empty(), "recomputed users are published");
+
+    std::cout << (failures == 0 ? "ConcurrencyTest passed" : "ConcurrencyTest failed") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file PrecisionSweep.cpp
+ * @brief Measures how often ComputePrecision::Float changes a result of the Double path.
+ *
+ * Runs computeBfpColumns in both precisions over every measurement tuple of the input grid and
+ * counts the tuples whose category or truncated BFP differ. This is the sweep behind the rates
+ * documented on ComputePrecision; "make sweep" builds and runs it.
+ */
+#define main healthAssistantMain
+#include "../HealthAssistant.cpp"
+#undef main
+
+namespace {
+
+struct SweepResult {
+    std::uint64_t tuples = 0;
+    std::uint64_t categoryFlips = 0;
+    std::uint64_t bfpDifferences = 0;
+};
+
+/**
+ * @brief Runs both kernels over a chunk of tuples and adds their differences to the result.
+ */
+void compare(const MeasurementColumns<double> &exact, const MeasurementColumns<float> &reduced, BfpType bfpType, SweepResult &result)
+{
+    std::vector<int> bfp, reducedBfp;
+    std::vector<BfpCategory> category, reducedCategory;
+    computeBfpColumns(exact, bfpType, bfp, category);
+    computeBfpColumns(reduced, bfpType, reducedBfp, reducedCategory);
+    for (std::size_t i = 0; i < bfp.size(); i++)
+    {
+        result.categoryFlips += category[i] != reducedCategory[i];
+        result.bfpDifferences += bfp[i] != reducedBfp[i];
+    }
+    result.tuples += bfp.size();
+}
+
+template <typename Real>
+void append(MeasurementColumns<Real> &columns, Gender gender, int age, double weight, double waist, double neck, double hip, double height)
+{
+    columns.weight.push_back(static_cast<Real>(weight));
+    columns.waist.push_back(static_cast<Real>(waist));
+    columns.neck.push_back(static_cast<Real>(neck));
+    columns.hip.push_back(static_cast<Real>(hip));
+    columns.height.push_back(static_cast<Real>(height));
+    columns.age.push_back(age);
+    columns.gender.push_back(gender);
+}
+
+// Grid points are computed from integer steps so that every value is the double a user would enter
+double gridValue(double first, double step, int index)
+{
+    return std::round((first + step * index) * 10) / 10;
+}
+
+void report(const char *method, const SweepResult &result)
+{
+    std::cout << method << ": " << result.tuples << " tuples, " << result.categoryFlips << " category flips ("
+              << static_cast<double>(result.categoryFlips) / result.tuples << "), " << result.bfpDifferences
+              << " truncated BFP differences (" << static_cast<double>(result.bfpDifferences) / result.tuples << ")" << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+    // Heights 150-200 cm, weights 40-150 kg, waists 60-130 cm, necks 28-50 cm, hips 80-130 cm
+    const int heights = 101, weights = 1101, waists = 141, necks = 45, hips = 101;
+    const int ages[] = { 30, 50, 70 };
+
+    SweepResult bmi;
+    for (int h = 0; h < heights; h++)
+    {
+        MeasurementColumns<double> exact;
+        MeasurementColumns<float> reduced;
+        for (int w = 0; w < weights; w++)
+        {
+            append(exact, Gender::Male, 30, gridValue(40, 0.1, w), 0, 0, 0, gridValue(150, 0.5, h));
+            append(reduced, Gender::Male, 30, gridValue(40, 0.1, w), 0, 0, 0, gridValue(150, 0.5, h));
+        }
+        compare(exact, reduced, BfpType::BmiMethod, bmi);
+    }
+    report("BMI", bmi);
+
+    SweepResult usNavy;
+    for (int age : ages)
+    {
+        for (int h = 0; h < heights; h++)
+        {
+            for (int n = 0; n < necks; n++)
+            {
+                MeasurementColumns<double> exact;
+                MeasurementColumns<float> reduced;
+                for (int w = 0; w < waists; w++)
+                {
+                    double height = gridValue(150, 0.5, h), neck = gridValue(28, 0.5, n), waist = gridValue(60, 0.5, w);
+                    append(exact, Gender::Male, age, 0, waist, neck, 0, height);
+                    append(reduced, Gender::Male, age, 0, waist, neck, 0, height);
+                    for (int p = 0; p < hips; p++)
+                    {
+                        double hip = gridValue(80, 0.5, p);
+                        append(exact, Gender::Female, age, 0, waist, neck, hip, height);
+                        append(reduced, Gender::Female, age, 0, waist, neck, hip, height);
+                    }
+                }
+                compare(exact, reduced, BfpType::USNavyMethod, usNavy);
+            }
+        }
+    }
+    report("US Navy", usNavy);
+    return 0;
+}